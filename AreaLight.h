@@ -0,0 +1,136 @@
+/**
+@file AreaLight.h
+*/
+#pragma once
+#ifndef _AREA_LIGHT_H_
+#define _AREA_LIGHT_H_
+
+#include <cmath>
+#include "Material.h"
+#include "PointLight.h"
+#include "Sphere.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A light with an area, which casts soft shadows. Its position (the
+  /// one of PointLight, which may be moved in the viewer) is its
+  /// center. Shading uses the direction of the center, while shadows
+  /// are computed from points sampled on its surface (see
+  /// Renderer::addLight).
+  struct AreaLight : public PointLight {
+
+    /// Constructor. \a light_number must be different for every light
+    /// (GL_LIGHT0, GL_LIGHT1, etc).
+    AreaLight( GLenum light_number, Point3 center, Color emission_color )
+      : PointLight( light_number, Point4( center[ 0 ], center[ 1 ], center[ 2 ], 1.0f ),
+                    emission_color )
+    {}
+
+    bool hasArea() const { return true; }
+
+  protected:
+    /// @return the current center.
+    Point3 center() const
+    {
+      return Point3( position[ 0 ] / position[ 3 ], position[ 1 ] / position[ 3 ],
+                     position[ 2 ] / position[ 3 ] );
+    }
+
+    /// @return the sample of the light at \a q seen from \a p.
+    LightSample toward( const Vector3& p, const Point3& q ) const
+    {
+      LightSample s;
+      Vector3 w = q - p;
+      s.distance  = w.norm();
+      s.direction = s.distance > 0.0f ? w / s.distance : w;
+      s.color     = emission;
+      return s;
+    }
+  };
+
+  /// A light emitting from a parallelogram centered on its position,
+  /// whose sides are the vectors \a u and \a v.
+  struct RectangleLight : public AreaLight {
+    /// The sides of the parallelogram.
+    Vector3 u, v;
+
+    /// Constructor. \a light_number must be different for every light
+    /// (GL_LIGHT0, GL_LIGHT1, etc).
+    RectangleLight( GLenum light_number, Point3 center,
+                    Vector3 side_u, Vector3 side_v, Color emission_color )
+      : AreaLight( light_number, center, emission_color ), u( side_u ), v( side_v )
+    {}
+
+    /// Displays the parallelogram with the color of the light.
+    void draw( Viewer& viewer )
+    {
+      Point3 c = center();
+      glBegin( GL_QUADS );
+      glColor4fv( emission );
+      glVertex3fv( c - 0.5f * u - 0.5f * v );
+      glVertex3fv( c + 0.5f * u - 0.5f * v );
+      glVertex3fv( c + 0.5f * u + 0.5f * v );
+      glVertex3fv( c - 0.5f * u + 0.5f * v );
+      glEnd();
+      PointLight::draw( viewer );
+    }
+
+    using PointLight::sample;
+    /// @return the sample of the point at (\a su, \a sv) in [0,1]^2 on
+    /// the parallelogram.
+    LightSample sample( const Vector3& p, Real su, Real sv ) const
+    {
+      return toward( p, center() + ( su - 0.5f ) * u + ( sv - 0.5f ) * v );
+    }
+  };
+
+  /// A light emitting from a sphere centered on its position. Seen
+  /// from a point, the sphere is sampled on its disc facing the point,
+  /// which is a good approximation of its silhouette when the point is
+  /// not too close.
+  struct SphereLight : public AreaLight {
+    /// The radius of the sphere.
+    Real radius;
+
+    /// Constructor. \a light_number must be different for every light
+    /// (GL_LIGHT0, GL_LIGHT1, etc).
+    SphereLight( GLenum light_number, Point3 center, Real r, Color emission_color )
+      : AreaLight( light_number, center, emission_color ), radius( r )
+    {}
+
+    /// Displays the sphere with the color of the light.
+    void draw( Viewer& viewer )
+    {
+      Sphere( center(), radius, Material( emission, emission, emission ) ).draw( viewer );
+      PointLight::draw( viewer );
+    }
+
+    using PointLight::sample;
+    /// @return the sample of the point at (\a su, \a sv) in [0,1]^2 on
+    /// the disc of the sphere facing \a p (concentric mapping, which
+    /// keeps the strata of [0,1]^2 compact).
+    LightSample sample( const Vector3& p, Real su, Real sv ) const
+    {
+      Point3 c = center();
+      Vector3 w = c - p;
+      Real d = w.norm();
+      if ( d <= radius ) return toward( p, c );
+      w /= d;
+      // An orthonormal basis (a, b) of the disc.
+      Vector3 a = std::fabs( w[ 0 ] ) < 0.9f ? Vector3( 1, 0, 0 ) : Vector3( 0, 1, 0 );
+      a = a - a.dot( w ) * w;
+      a /= a.norm();
+      Vector3 b = w.cross( a );
+      Real x = 2.0f * su - 1.0f, y = 2.0f * sv - 1.0f;
+      Real r, t;
+      if ( x == 0.0f && y == 0.0f ) { r = 0.0f; t = 0.0f; }
+      else if ( std::fabs( x ) > std::fabs( y ) ) { r = x; t = ( M_PI / 4.0 ) * y / x; }
+      else { r = y; t = M_PI / 2.0 - ( M_PI / 4.0 ) * x / y; }
+      return toward( p, c + radius * r * ( cos( t ) * a + sin( t ) * b ) );
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _AREA_LIGHT_H_
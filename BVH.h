@@ -0,0 +1,469 @@
+/**
+@file BVH.h
+*/
+#pragma once
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "BoundingBox.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A bounding volume hierarchy over items of type \a TItem (pointers
+  /// to objects, indices of primitives). Every leaf holds exactly one
+  /// item, and nodes are stored in a vector, so that the tree can be
+  /// modified incrementally:
+  ///
+  /// - build() creates a good tree from scratch (binned SAH),
+  /// - insert() / remove() add or delete one leaf,
+  /// - refit() changes the box of one leaf when its item moves.
+  ///
+  /// The quality of the tree is measured by its SAH cost (sum of the
+  /// areas of all nodes relative to the area of the root), which is
+  /// maintained incrementally. When incremental changes have degraded
+  /// it too much, needsRebuild() tells the owner to call build() again.
+  ///
+  /// A tree can also use nodes stored elsewhere (e.g. a memory-mapped
+  /// file written from data()), see map(). It is then read-only.
+  template <typename TItem>
+  struct BVH {
+    typedef TItem Item;
+
+    /// Index of a missing node.
+    static const int NONE = -1;
+    /// The height of the tree is kept below this, so that traversal can
+    /// use a fixed-size stack.
+    static const int MAX_HEIGHT = 60;
+
+    struct Node {
+      /// bounding box of the subtree
+      BoundingBox box;
+      /// parent node, or next free node when it is in the free list.
+      int parent;
+      /// children (NONE for leaves)
+      int left, right;
+      /// height of the subtree (0 for leaves)
+      int height;
+      /// the item (valid for leaves only).
+      Item item;
+      bool isLeaf() const { return left == NONE; }
+    };
+
+    /// Default constructor. The tree is empty.
+    BVH() { clear(); }
+
+    /// Empties the tree.
+    void clear()
+    {
+      myNodes.clear();
+      myMapped = 0;
+      myNbMapped = 0;
+      myRoot = NONE;
+      myFree = NONE;
+      myNbLeaves = 0;
+      mySumArea = 0.0;
+      myBuildCost = 0.0;
+    }
+
+    /// @return the number of items stored in the tree.
+    int size() const { return myNbLeaves; }
+
+    const Node& node( int n ) const { return data()[ n ]; }
+    int root() const { return myRoot; }
+
+    /// @return the array of nodes (free ones included), so that the
+    /// tree can be saved and mapped back with map().
+    const Node* data() const { return myMapped != 0 ? myMapped : myNodes.data(); }
+    /// @return the number of nodes of data().
+    int nbNodes() const { return myMapped != 0 ? myNbMapped : (int) myNodes.size(); }
+
+    /// Uses the \a nb_nodes nodes stored at \a nodes, as given by
+    /// data(), instead of its own. They are not copied and must outlive
+    /// the tree, which cannot be modified anymore (until clear() or
+    /// build()).
+    void map( const Node* nodes, int nb_nodes, int root, int nb_leaves )
+    {
+      clear();
+      myMapped   = nodes;
+      myNbMapped = nb_nodes;
+      myRoot     = root;
+      myNbLeaves = nb_leaves;
+      // The cost is only useful to incremental changes.
+      myBuildCost = 0.0f;
+    }
+
+    /// Rebuilds the whole tree from the given items and their boxes.
+    /// @param[out] leaves leaves[ i ] is the leaf holding items[ i ].
+    void build( const std::vector<Item>& items, const std::vector<BoundingBox>& boxes,
+                std::vector<int>& leaves )
+    {
+      assert( items.size() == boxes.size() );
+      clear();
+      leaves.resize( items.size() );
+      if ( items.empty() ) return;
+      myNodes.reserve( 2 * items.size() );
+      std::vector<BuildRef> refs( items.size() );
+      BoundingBox centroids;
+      for ( std::size_t i = 0; i < items.size(); ++i ) {
+        refs[ i ].box   = boxes[ i ];
+        refs[ i ].index = (int) i;
+        centroids.extend( refs[ i ].centroid() );
+      }
+      myRoot = buildRange( items, leaves, refs, 0, (int) refs.size(), centroids, NONE, 0 );
+      assert( myNodes[ myRoot ].height < MAX_HEIGHT );
+      myNbLeaves = (int) items.size();
+      myBuildCost = cost();
+    }
+
+    /// Inserts an item with the given box.
+    /// @return the leaf holding it (needed by remove() and refit()).
+    int insert( const Item& item, const BoundingBox& box )
+    {
+      assert( myMapped == 0 );
+      int leaf = allocate();
+      myNodes[ leaf ].box  = box;
+      myNodes[ leaf ].item = item;
+      mySumArea += box.area();
+      ++myNbLeaves;
+      if ( myRoot == NONE ) {
+        myRoot = leaf;
+        myBuildCost = cost();
+        return leaf;
+      }
+      int sibling = bestSibling( box );
+      int old_parent = myNodes[ sibling ].parent;
+      int new_parent = allocate();
+      myNodes[ new_parent ].parent = old_parent;
+      myNodes[ new_parent ].left   = sibling;
+      myNodes[ new_parent ].right  = leaf;
+      myNodes[ new_parent ].box    = box.merge( myNodes[ sibling ].box );
+      mySumArea += myNodes[ new_parent ].box.area();
+      myNodes[ sibling ].parent = new_parent;
+      myNodes[ leaf ].parent    = new_parent;
+      if ( old_parent == NONE ) myRoot = new_parent;
+      else if ( myNodes[ old_parent ].left == sibling ) myNodes[ old_parent ].left = new_parent;
+      else myNodes[ old_parent ].right = new_parent;
+      updateAncestors( new_parent );
+      return leaf;
+    }
+
+    /// Removes the given leaf (as returned by insert() or build()).
+    void remove( int leaf )
+    {
+      assert( myMapped == 0 );
+      assert( myNodes[ leaf ].isLeaf() );
+      mySumArea -= myNodes[ leaf ].box.area();
+      --myNbLeaves;
+      int parent = myNodes[ leaf ].parent;
+      release( leaf );
+      if ( parent == NONE ) { myRoot = NONE; return; }
+      int sibling = myNodes[ parent ].left == leaf
+        ? myNodes[ parent ].right : myNodes[ parent ].left;
+      int grand_parent = myNodes[ parent ].parent;
+      mySumArea -= myNodes[ parent ].box.area();
+      release( parent );
+      myNodes[ sibling ].parent = grand_parent;
+      if ( grand_parent == NONE ) { myRoot = sibling; return; }
+      if ( myNodes[ grand_parent ].left == parent ) myNodes[ grand_parent ].left = sibling;
+      else myNodes[ grand_parent ].right = sibling;
+      updateAncestors( grand_parent );
+    }
+
+    /// Gives a new box to the given leaf, and refits its ancestors.
+    void refit( int leaf, const BoundingBox& box )
+    {
+      assert( myMapped == 0 );
+      assert( myNodes[ leaf ].isLeaf() );
+      mySumArea += box.area() - myNodes[ leaf ].box.area();
+      myNodes[ leaf ].box = box;
+      if ( myNodes[ leaf ].parent != NONE ) updateAncestors( myNodes[ leaf ].parent );
+    }
+
+    /// @return the SAH cost of the tree, i.e. the expected number of
+    /// nodes visited by a ray hitting the root box.
+    Real cost() const
+    {
+      if ( myRoot == NONE || myMapped != 0 ) return 0.0f;
+      Real root_area = myNodes[ myRoot ].box.area();
+      return root_area > 0.0f ? (Real) ( mySumArea / root_area ) : 0.0f;
+    }
+
+    /// @return the cost of the tree after the last call to build().
+    Real buildCost() const { return myBuildCost; }
+
+    /// @return 'true' when the cost of the tree has grown by more than
+    /// the factor \a threshold since the last build, or when it has
+    /// become too deep.
+    bool needsRebuild( Real threshold ) const
+    {
+      if ( myRoot == NONE || myMapped != 0 ) return false;
+      return myNodes[ myRoot ].height >= MAX_HEIGHT
+        || cost() > threshold * myBuildCost;
+    }
+
+    /// Looks for the closest item intersected by the ray. \a test( item,
+    /// tmax ) must intersect the item and lower \a tmax when it is hit
+    /// before \a tmax. Subtrees are visited front to back and skipped
+    /// when they start after \a tmax.
+    template <typename Test>
+    void closest( const Ray& ray, Real& tmax, Test& test ) const
+    {
+      if ( myRoot == NONE ) return;
+      const Node* nodes = data();
+      Vector3 inv_dir = BoundingBox::inverse( ray.direction );
+      Real t;
+      if ( ! nodes[ myRoot ].box.intersect( ray.origin, inv_dir, tmax, t ) ) return;
+      int  stack_node[ 2 * MAX_HEIGHT + 2 ];
+      Real stack_t   [ 2 * MAX_HEIGHT + 2 ];
+      int top = 0;
+      stack_node[ top ] = myRoot; stack_t[ top++ ] = t;
+      while ( top > 0 ) {
+        --top;
+        if ( stack_t[ top ] > tmax ) continue;
+        const Node& n = nodes[ stack_node[ top ] ];
+        if ( n.isLeaf() ) {
+          test( n.item, tmax );
+          continue;
+        }
+        Real tl = 0.0f, tr = 0.0f;
+        bool hl = nodes[ n.left  ].box.intersect( ray.origin, inv_dir, tmax, tl );
+        bool hr = nodes[ n.right ].box.intersect( ray.origin, inv_dir, tmax, tr );
+        if ( hl && hr ) {
+          // Pushes the farthest child first, so that the nearest is visited first.
+          bool left_first = tl <= tr;
+          stack_node[ top ] = left_first ? n.right : n.left;
+          stack_t   [ top++ ] = left_first ? tr : tl;
+          stack_node[ top ] = left_first ? n.left : n.right;
+          stack_t   [ top++ ] = left_first ? tl : tr;
+        } else if ( hl ) {
+          stack_node[ top ] = n.left;  stack_t[ top++ ] = tl;
+        } else if ( hr ) {
+          stack_node[ top ] = n.right; stack_t[ top++ ] = tr;
+        }
+      }
+    }
+
+  private:
+    /// Used during build. Boxes are copied so that they are accessed
+    /// contiguously.
+    struct BuildRef {
+      BoundingBox box;
+      int index;
+      /// bin of the item along the current split axis
+      int bin;
+      /// @return twice the center of the box along \a axis.
+      Real centroid( int axis ) const { return box.lo[ axis ] + box.hi[ axis ]; }
+      /// @return twice the center of the box.
+      Point3 centroid() const { return box.lo + box.hi; }
+    };
+
+    /// Number of bins used by the SAH build.
+    static const int NB_BINS = 12;
+    /// Ranges with at most this number of items are split at the median.
+    static const int SMALL_RANGE = 6;
+
+    std::vector<Node> myNodes;
+    /// nodes given to map() (0 when the tree uses myNodes)
+    const Node* myMapped;
+    int myNbMapped;
+    int myRoot;
+    /// first node of the free list
+    int myFree;
+    int myNbLeaves;
+    /// Sum of the areas of all nodes (double to limit drift).
+    double mySumArea;
+    Real myBuildCost;
+
+    int allocate()
+    {
+      int n;
+      if ( myFree != NONE ) {
+        n = myFree;
+        myFree = myNodes[ n ].parent;
+      } else {
+        n = (int) myNodes.size();
+        myNodes.push_back( Node() );
+      }
+      Node& node = myNodes[ n ];
+      node.parent = node.left = node.right = NONE;
+      node.height = 0;
+      return n;
+    }
+
+    void release( int n )
+    {
+      myNodes[ n ].parent = myFree;
+      myNodes[ n ].left   = NONE;
+      myNodes[ n ].height = -1;
+      myFree = n;
+    }
+
+    /// Recomputes boxes and heights from \a n up to the root.
+    void updateAncestors( int n )
+    {
+      while ( n != NONE ) {
+        Node& node = myNodes[ n ];
+        const Node& l = myNodes[ node.left ];
+        const Node& r = myNodes[ node.right ];
+        mySumArea -= node.box.area();
+        node.box = l.box.merge( r.box );
+        mySumArea += node.box.area();
+        node.height = 1 + std::max( l.height, r.height );
+        n = node.parent;
+      }
+    }
+
+    /// Branch and bound search of the node whose sibling the new box
+    /// should become, minimizing the total area increase.
+    int bestSibling( const BoundingBox& box ) const
+    {
+      Real box_area = box.area();
+      int best = myRoot;
+      Real best_cost = box.merge( myNodes[ myRoot ].box ).area();
+      // Area increase of ancestors when descending.
+      std::vector< std::pair<int, Real> > queue;
+      queue.push_back( std::make_pair( myRoot, 0.0f ) );
+      while ( ! queue.empty() ) {
+        int n = queue.back().first;
+        Real inherited = queue.back().second;
+        queue.pop_back();
+        const Node& node = myNodes[ n ];
+        Real merged = box.merge( node.box ).area();
+        Real c = merged + inherited;
+        if ( c < best_cost ) { best_cost = c; best = n; }
+        if ( node.isLeaf() ) continue;
+        Real child_inherited = inherited + merged - node.box.area();
+        if ( box_area + child_inherited < best_cost ) {
+          queue.push_back( std::make_pair( node.left,  child_inherited ) );
+          queue.push_back( std::make_pair( node.right, child_inherited ) );
+        }
+      }
+      return best;
+    }
+
+    /// Builds the subtree for refs[begin,end[, returns its root.
+    /// \a centroids bounds the centroids of the range. The SAH may peel
+    /// off one item per level, so the range is split at the median once
+    /// a median tree is all that still fits below MAX_HEIGHT at \a depth.
+    int buildRange( const std::vector<Item>& items, std::vector<int>& leaves,
+                    std::vector<BuildRef>& refs, int begin, int end,
+                    const BoundingBox& centroids, int parent, int depth )
+    {
+      int n = allocate();
+      myNodes[ n ].parent = parent;
+      if ( end - begin == 1 ) {
+        const BuildRef& r = refs[ begin ];
+        myNodes[ n ].box  = r.box;
+        myNodes[ n ].item = items[ r.index ];
+        mySumArea += r.box.area();
+        leaves[ r.index ] = n;
+        return n;
+      }
+      BoundingBox left_centroids, right_centroids;
+      int mid   = depth + ceilLog2( end - begin ) + 1 >= MAX_HEIGHT
+        ? splitMedian( refs, begin, end, centroids.longestAxis(), left_centroids, right_centroids )
+        : splitSAH( refs, begin, end, centroids, left_centroids, right_centroids );
+      int left  = buildRange( items, leaves, refs, begin, mid, left_centroids, n, depth + 1 );
+      int right = buildRange( items, leaves, refs, mid, end, right_centroids, n, depth + 1 );
+      // myNodes may have been reallocated by the recursive calls.
+      Node& node = myNodes[ n ];
+      node.left   = left;
+      node.right  = right;
+      node.box    = myNodes[ left ].box.merge( myNodes[ right ].box );
+      node.height = 1 + std::max( myNodes[ left ].height, myNodes[ right ].height );
+      mySumArea  += node.box.area();
+      return n;
+    }
+
+    /// @return the smallest h such that n <= 2^h.
+    static int ceilLog2( int n )
+    {
+      int h = 0;
+      while ( ( 1 << h ) < n ) ++h;
+      return h;
+    }
+
+    /// Partitions refs[begin,end[ along the longest axis of the
+    /// centroids with the binned SAH and returns the split position.
+    /// Falls back to a median split when centroids are degenerate.
+    /// The centroid bounds of both parts are computed during binning,
+    /// which saves a pass over the items at each level.
+    int splitSAH( std::vector<BuildRef>& refs, int begin, int end,
+                  const BoundingBox& centroids,
+                  BoundingBox& left_centroids, BoundingBox& right_centroids )
+    {
+      int axis = centroids.longestAxis();
+      Real c0 = centroids.lo[ axis ];
+      Real extent = centroids.hi[ axis ] - c0;
+      int mid = ( begin + end ) / 2;
+      Real scale = NB_BINS / extent;
+      // Tiny (denormal) extents overflow the scale as well.
+      if ( extent <= 0.0f || scale > std::numeric_limits<Real>::max() ) {
+        left_centroids = right_centroids = centroids;
+        return mid;
+      }
+      // Binning is not worth it for a few items.
+      if ( end - begin <= SMALL_RANGE ) return splitMedian( refs, begin, end, axis,
+                                                           left_centroids, right_centroids );
+      BoundingBox bin_box[ NB_BINS ];
+      BoundingBox bin_centroids[ NB_BINS ];
+      int bin_count[ NB_BINS ] = { 0 };
+      for ( int i = begin; i < end; ++i ) {
+        BuildRef& r = refs[ i ];
+        r.bin = std::min( NB_BINS - 1, (int) ( ( r.centroid( axis ) - c0 ) * scale ) );
+        bin_count[ r.bin ] += 1;
+        bin_box[ r.bin ].extend( r.box );
+        bin_centroids[ r.bin ].extend( r.centroid() );
+      }
+      // Sweeps from the right to get the cost of every right part.
+      Real right_cost[ NB_BINS ];
+      BoundingBox acc;
+      int count = 0;
+      for ( int b = NB_BINS - 1; b > 0; --b ) {
+        acc.extend( bin_box[ b ] );
+        count += bin_count[ b ];
+        right_cost[ b ] = acc.area() * count;
+      }
+      acc = BoundingBox();
+      count = 0;
+      int best_bin = -1;
+      Real best_cost = 0.0f;
+      for ( int b = 0; b < NB_BINS - 1; ++b ) {
+        acc.extend( bin_box[ b ] );
+        count += bin_count[ b ];
+        if ( count == 0 || count == end - begin ) continue;
+        Real c = acc.area() * count + right_cost[ b + 1 ];
+        if ( best_bin < 0 || c < best_cost ) { best_cost = c; best_bin = b; }
+      }
+      if ( best_bin < 0 ) return splitMedian( refs, begin, end, axis,
+                                              left_centroids, right_centroids );
+      for ( int b = 0; b < NB_BINS; ++b )
+        ( b <= best_bin ? left_centroids : right_centroids ).extend( bin_centroids[ b ] );
+      BuildRef* split = std::partition( refs.data() + begin, refs.data() + end,
+                                        [best_bin] ( const BuildRef& r )
+                                        { return r.bin <= best_bin; } );
+      return (int) ( split - refs.data() );
+    }
+
+    /// Splits refs[begin,end[ in two halves along \a axis.
+    int splitMedian( std::vector<BuildRef>& refs, int begin, int end, int axis,
+                     BoundingBox& left_centroids, BoundingBox& right_centroids )
+    {
+      int mid = ( begin + end ) / 2;
+      std::nth_element( refs.begin() + begin, refs.begin() + mid, refs.begin() + end,
+                        [axis] ( const BuildRef& a, const BuildRef& b )
+                        { return a.centroid( axis ) < b.centroid( axis ); } );
+      for ( int i = begin; i < end; ++i )
+        ( i < mid ? left_centroids : right_centroids ).extend( refs[ i ].centroid() );
+      return mid;
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _BVH_H_
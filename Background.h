@@ -0,0 +1,103 @@
+/**
+@file Background.h
+*/
+#pragma once
+#ifndef _BACKGROUND_H_
+#define _BACKGROUND_H_
+
+#include <algorithm>
+#include <math.h>
+#include "Color.h"
+#include "Ray.h"
+#include "Image2D.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+    struct Light;
+
+    /// Gives the color seen by the rays that do not hit any object.
+    struct Background {
+        /// Virtual destructor since object contains virtual methods.
+        virtual ~Background() {}
+
+        virtual Color backgroundColor(const Ray &ray) = 0;
+
+        /// @return 'true' if the disc of \a light is already part of the
+        /// background (see EnvironmentMap), so that Renderer::background
+        /// must not add it.
+        virtual bool includesLight(const Light * /* light */) const { return false; }
+    };
+
+    /// A blue sky above a checkerboard floor.
+    struct BasicBackground : public Background {
+        Color backgroundColor(const Ray &ray) {
+            if (ray.direction[2] >= 0 && ray.direction[2] <= 1.0)
+                return skyColor(ray);
+            return floorColor(ray);
+        }
+
+        /// @return the color of the sky (ray.direction[2] >= 0).
+        virtual Color skyColor(const Ray &ray) {
+            return Color(1.0f, 1.0f, 1.0f) + ray.direction[2] * (Color(0.0f, 0.0f, 1.0f) - Color(1.0f, 1.0f, 1.0f));
+        }
+
+        /// @return the color of the checkerboard floor (ray.direction[2] < 0).
+        Color floorColor(const Ray &ray) {
+            Color result = Color(0.0f, 0.0f, 0.0f);
+            Real x = -0.5f * ray.direction[0] / ray.direction[2];
+            Real y = -0.5f * ray.direction[1] / ray.direction[2];
+            Real d = sqrt(x * x + y * y);
+            Real t = std::min(d, 30.0f) / 30.0f;
+            x -= floor(x);
+            y -= floor(y);
+            if (((x >= 0.5f) && (y >= 0.5f)) || ((x < 0.5f) && (y < 0.5f)))
+                result += (1.0f - t) * Color(0.2f, 0.2f, 0.2f) + t * Color(1.0f, 1.0f, 1.0f);
+            else
+                result += (1.0f - t) * Color(0.4f, 0.4f, 0.4f) + t * Color(1.0f, 1.0f, 1.0f);
+            return result;
+        }
+    };
+
+    /// The sky of a fish-eye photo (see tp-ig-2.dox, 5.8) above the
+    /// checkerboard floor. The photo is looking at the zenith, its
+    /// inscribed disc being the upper hemisphere: the distance to the
+    /// center of the photo is proportional to the angle between the ray
+    /// and the zenith (equidistant projection), and the x axis points
+    /// to the right of the photo, the y axis to its top.
+    ///
+    /// Each ray needs an acos, a sqrt and a bilinear interpolation in the
+    /// photo, so it is better used through an EnvironmentMap.
+    struct FisheyeSky : public BasicBackground {
+        /// Creates the sky of the given photo (copied).
+        FisheyeSky(const Image2D<Color> &aPhoto) : photo(aPhoto) {}
+
+        Color skyColor(const Ray &ray) {
+            const Vector3 &d = ray.direction;
+            Real l = sqrt(d[0] * d[0] + d[1] * d[1]);
+            Real radius = 0.5f * (Real) std::min(photo.w(), photo.h());
+            // angle to the zenith divided by pi/2, times the radius.
+            Real r = l > 0.0f ? radius * acos(std::min(d[2], 1.0f)) / (0.5f * (Real) M_PI) / l : 0.0f;
+            return bilinear(0.5f * photo.w() + r * d[0] - 0.5f, 0.5f * photo.h() - r * d[1] - 0.5f);
+        }
+
+        /// @return the color of the photo at (x,y), bilinearly
+        /// interpolated between pixel centers.
+        Color bilinear(Real x, Real y) const {
+            x = std::max(0.0f, std::min(x, (Real) (photo.w() - 1)));
+            y = std::max(0.0f, std::min(y, (Real) (photo.h() - 1)));
+            int i = (int) x, j = (int) y;
+            int i1 = std::min(i + 1, photo.w() - 1), j1 = std::min(j + 1, photo.h() - 1);
+            Real fx = x - i, fy = y - j;
+            return (1.0f - fy) * ((1.0f - fx) * photo.at(i, j) + fx * photo.at(i1, j))
+                   + fy * ((1.0f - fx) * photo.at(i, j1) + fx * photo.at(i1, j1));
+        }
+
+        /// The fish-eye photo.
+        Image2D<Color> photo;
+    };
+
+
+} // namespace rt
+
+#endif // #define _BACKGROUND_H_
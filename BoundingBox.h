@@ -0,0 +1,150 @@
+/**
+@file BoundingBox.h
+*/
+#pragma once
+#ifndef _BOUNDING_BOX_H_
+#define _BOUNDING_BOX_H_
+
+#include <algorithm>
+#include <limits>
+#include "PointVector.h"
+#include "Ray.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// An axis-aligned bounding box, given by its lowest and uppermost
+  /// points. An empty box has lo > hi, an unbounded box has infinite
+  /// coordinates.
+  struct BoundingBox {
+    /// lowest point of the box
+    Point3 lo;
+    /// uppermost point of the box
+    Point3 hi;
+
+    /// Default constructor. The box is empty.
+    BoundingBox()
+      : lo( inf(), inf(), inf() ), hi( -inf(), -inf(), -inf() )
+    {}
+
+    /// Creates the box [a,b].
+    BoundingBox( const Point3& a, const Point3& b )
+      : lo( a ), hi( b )
+    {}
+
+    /// @return a box containing the whole space.
+    static BoundingBox infinite()
+    {
+      return BoundingBox( Point3( -inf(), -inf(), -inf() ),
+                          Point3(  inf(),  inf(),  inf() ) );
+    }
+
+    static Real inf() { return std::numeric_limits<Real>::infinity(); }
+
+    bool isEmpty() const
+    { return lo[ 0 ] > hi[ 0 ] || lo[ 1 ] > hi[ 1 ] || lo[ 2 ] > hi[ 2 ]; }
+
+    bool isBounded() const
+    {
+      for ( int i = 0; i < 3; ++i )
+        if ( ! std::isfinite( lo[ i ] ) || ! std::isfinite( hi[ i ] ) ) return false;
+      return true;
+    }
+
+    /// Extends the box so that it contains the point \a p.
+    BoundingBox& extend( const Point3& p )
+    {
+      for ( int i = 0; i < 3; ++i ) {
+        lo[ i ] = std::min( lo[ i ], p[ i ] );
+        hi[ i ] = std::max( hi[ i ], p[ i ] );
+      }
+      return *this;
+    }
+
+    /// Extends the box so that it contains the box \a other.
+    BoundingBox& extend( const BoundingBox& other )
+    {
+      for ( int i = 0; i < 3; ++i ) {
+        lo[ i ] = std::min( lo[ i ], other.lo[ i ] );
+        hi[ i ] = std::max( hi[ i ], other.hi[ i ] );
+      }
+      return *this;
+    }
+
+    /// @return the smallest box containing this box and \a other.
+    BoundingBox merge( const BoundingBox& other ) const
+    {
+      BoundingBox tmp( *this );
+      return tmp.extend( other );
+    }
+
+    bool contains( const BoundingBox& other ) const
+    {
+      for ( int i = 0; i < 3; ++i )
+        if ( other.lo[ i ] < lo[ i ] || other.hi[ i ] > hi[ i ] ) return false;
+      return true;
+    }
+
+    Point3 center() const { return 0.5f * ( lo + hi ); }
+
+    /// @return the index of the longest axis of the box.
+    int longestAxis() const
+    {
+      Vector3 d = hi - lo;
+      return ( d[ 0 ] >= d[ 1 ] && d[ 0 ] >= d[ 2 ] ) ? 0 : ( d[ 1 ] >= d[ 2 ] ? 1 : 2 );
+    }
+
+    /// @return the surface area of the box (0 if empty), the usual
+    /// measure of the probability of a ray to hit it.
+    Real area() const
+    {
+      if ( isEmpty() ) return 0.0f;
+      Vector3 d = hi - lo;
+      return 2.0f * ( d[ 0 ] * d[ 1 ] + d[ 1 ] * d[ 2 ] + d[ 2 ] * d[ 0 ] );
+    }
+
+    /// Slab test. \a inv_dir is the componentwise inverse of the ray
+    /// direction. It is conservative: the exit distances are enlarged by
+    /// the maximal rounding error, so that rays going exactly through an
+    /// edge or a vertex of a primitive lying on the box are not culled
+    /// (Ize, "Robust BVH ray traversal", 2013).
+    ///
+    /// @return 'true' if the ray enters the box before \a tmax, and then
+    /// \a tmin is the distance at which it enters it (0 if the origin is inside).
+    bool intersect( const Point3& origin, const Vector3& inv_dir,
+                    Real tmax, Real& tmin ) const
+    {
+      Real t0 = 0.0f;
+      Real t1 = tmax;
+      for ( int i = 0; i < 3; ++i ) {
+        Real ta = ( lo[ i ] - origin[ i ] ) * inv_dir[ i ];
+        Real tb = ( hi[ i ] - origin[ i ] ) * inv_dir[ i ];
+        // When the direction is (-)0 and the origin is on a slab plane,
+        // one of them is NaN (0 * inf): the origin is then in the slab,
+        // which does not cut the interval.
+        if ( ta != ta || tb != tb ) continue;
+        Real tnear = std::min( ta, tb );
+        Real tfar  = std::max( ta, tb ) * ( 1.0f + 6.0f * std::numeric_limits<Real>::epsilon() );
+        if ( tnear > t0 ) t0 = tnear;
+        if ( tfar  < t1 ) t1 = tfar;
+        if ( t0 > t1 ) return false;
+      }
+      tmin = t0;
+      return true;
+    }
+
+    bool intersect( const Ray& ray, Real tmax, Real& tmin ) const
+    {
+      return intersect( ray.origin, inverse( ray.direction ), tmax, tmin );
+    }
+
+    /// @return the componentwise inverse of \a dir, as needed by intersect.
+    static Vector3 inverse( const Vector3& dir )
+    {
+      return Vector3( 1.0f / dir[ 0 ], 1.0f / dir[ 1 ], 1.0f / dir[ 2 ] );
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _BOUNDING_BOX_H_
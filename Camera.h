@@ -0,0 +1,56 @@
+/**
+@file Camera.h
+*/
+#pragma once
+#ifndef _CAMERA_H_
+#define _CAMERA_H_
+
+#include <cmath>
+#include "PointVector.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A pinhole camera, given by its position, the point it looks at,
+  /// its up vector and its vertical field of view. It is used to place
+  /// the view when there is no interactive viewer (or to initialize it).
+  struct Camera {
+    /// position of the eye
+    Point3 position;
+    /// the point looked at
+    Point3 target;
+    /// the up direction of the view
+    Vector3 up;
+    /// vertical field of view in degrees
+    Real fov;
+
+    /// Default constructor. Looks at the origin from above the xy-plane.
+    Camera()
+      : position( 20.0f, -20.0f, 15.0f ), target( 0.0f, 0.0f, 0.0f ),
+        up( 0.0f, 0.0f, 1.0f ), fov( 45.0f )
+    {}
+
+    /// Computes the directions of the rays going through the corners of
+    /// a viewport of size \a width x \a height, as expected by
+    /// Renderer::setViewBox (the origin is \a position).
+    void getViewBox( int width, int height,
+                     Vector3& dirUL, Vector3& dirUR,
+                     Vector3& dirLL, Vector3& dirLR ) const
+    {
+      Vector3 f = target - position;
+      f /= f.norm();
+      Vector3 s = f.cross( up );
+      s /= s.norm();
+      Vector3 u = s.cross( f );
+      Real b = tan( fov * M_PI / 360.0 );
+      Real a = b * (Real) width / (Real) height;
+      dirUL = f - a * s + b * u;
+      dirUR = f + a * s + b * u;
+      dirLL = f - a * s - b * u;
+      dirLR = f + a * s - b * u;
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _CAMERA_H_
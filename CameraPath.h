@@ -0,0 +1,85 @@
+/**
+@file CameraPath.h
+*/
+#pragma once
+#ifndef _CAMERA_PATH_H_
+#define _CAMERA_PATH_H_
+
+#include <algorithm>
+#include <vector>
+#include "Camera.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A path of the camera through keyframes (cameras at given times),
+  /// as the paths of QGLViewer. Positions and targets are interpolated
+  /// by Catmull-Rom splines, which pass through the keyframes with a
+  /// continuous speed, and up vectors and fields of view linearly.
+  struct CameraPath {
+    /// A camera at a given time.
+    struct KeyFrame {
+      Real time;
+      Camera camera;
+    };
+
+    /// Adds the keyframe \a camera at \a time (keyframes may be added in
+    /// any order).
+    void addKeyFrame( Real time, const Camera& camera )
+    {
+      KeyFrame k = { time, camera };
+      auto it = std::upper_bound( myKeyFrames.begin(), myKeyFrames.end(), k,
+                                  []( const KeyFrame& a, const KeyFrame& b ) { return a.time < b.time; } );
+      myKeyFrames.insert( it, k );
+    }
+
+    /// @return the number of keyframes.
+    int nbKeyFrames() const { return (int) myKeyFrames.size(); }
+    /// @return the keyframe \a i, by increasing time.
+    const KeyFrame& keyFrame( int i ) const { return myKeyFrames[ i ]; }
+    /// @return the times of the first and of the last keyframes.
+    Real firstTime() const { return myKeyFrames.empty() ? 0.0f : myKeyFrames.front().time; }
+    Real lastTime() const { return myKeyFrames.empty() ? 0.0f : myKeyFrames.back().time; }
+
+    /// @return the camera at time \a t (the first or last keyframe out
+    /// of the path, the default camera if there is no keyframe).
+    Camera at( Real t ) const
+    {
+      int n = nbKeyFrames();
+      if ( n == 0 ) return Camera();
+      if ( t <= firstTime() ) return myKeyFrames.front().camera;
+      if ( t >= lastTime() ) return myKeyFrames.back().camera;
+      int i = 0;
+      while ( myKeyFrames[ i + 1 ].time < t ) ++i;
+      const KeyFrame& k1 = myKeyFrames[ i ];
+      const KeyFrame& k2 = myKeyFrames[ i + 1 ];
+      const Camera& c0 = myKeyFrames[ std::max( i - 1, 0 ) ].camera;
+      const Camera& c3 = myKeyFrames[ std::min( i + 2, n - 1 ) ].camera;
+      Real dt = k2.time - k1.time;
+      Real s = dt > 0.0f ? ( t - k1.time ) / dt : 0.0f;
+      Camera c;
+      c.position = catmullRom( c0.position, k1.camera.position, k2.camera.position, c3.position, s );
+      c.target = catmullRom( c0.target, k1.camera.target, k2.camera.target, c3.target, s );
+      c.up = ( 1.0f - s ) * k1.camera.up + s * k2.camera.up;
+      c.fov = ( 1.0f - s ) * k1.camera.fov + s * k2.camera.fov;
+      return c;
+    }
+
+  private:
+    std::vector<KeyFrame> myKeyFrames;
+
+    /// @return the point at \a s in [0,1] of the Catmull-Rom spline
+    /// between \a p1 and \a p2.
+    static Point3 catmullRom( const Point3& p0, const Point3& p1, const Point3& p2,
+                              const Point3& p3, Real s )
+    {
+      Real s2 = s * s, s3 = s2 * s;
+      return 0.5f * ( ( 2.0f * p1 ) + ( p2 - p0 ) * s
+                      + ( 2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 ) * s2
+                      + ( 3.0f * p1 - p0 - 3.0f * p2 + p3 ) * s3 );
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _CAMERA_PATH_H_
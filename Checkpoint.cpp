@@ -0,0 +1,162 @@
+/**
+@file Checkpoint.cpp
+*/
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Checkpoint.h"
+#include "PixelFormat.h"
+
+bool
+rt::Checkpoint::open(const std::string &filename, int width, int height, int tile_size,
+                     std::uint64_t key) {
+    close();
+    myFile = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (myFile < 0) {
+        std::cerr << "[Checkpoint::open] Unable to open " << filename << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RTCK", 4);
+    header.version = 1;
+    header.width = width;
+    header.height = height;
+    header.tile_size = tile_size;
+    header.key = key;
+    struct stat st;
+    long size = ::fstat(myFile, &st) == 0 ? (long) st.st_size : 0;
+    Header previous;
+    long valid = 0;
+    if (size >= (long) sizeof(Header) && ::pread(myFile, &previous, sizeof(Header), 0) == sizeof(Header)
+        && std::memcmp(&previous, &header, sizeof(Header)) == 0)
+        valid = load(size);
+    else if (size > 0)
+        std::cout << "Checkpoint " << filename << " is for another image, started again." << std::endl;
+    if (valid == 0) {
+        myRestored.clear();
+        if (::ftruncate(myFile, 0) != 0 || ::pwrite(myFile, &header, sizeof(Header), 0) != sizeof(Header)) {
+            std::cerr << "[Checkpoint::open] Unable to write " << filename << ": "
+                      << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+        valid = sizeof(Header);
+    } else if (valid < size && ::ftruncate(myFile, valid) != 0) {
+        // Removes the record cut by a crash.
+        std::cerr << "[Checkpoint::open] Unable to truncate " << filename << ": "
+                  << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    ::lseek(myFile, valid, SEEK_SET);
+    myLastFlush = std::chrono::steady_clock::now();
+    if (!myRestored.empty())
+        std::cout << myRestored.size() << " tiles restored from " << filename << "." << std::endl;
+    return true;
+}
+
+long
+rt::Checkpoint::load(long file_size) {
+    long offset = sizeof(Header);
+    std::vector<unsigned char> pixels;
+    while (offset + (long) sizeof(Record) <= file_size) {
+        Record record;
+        if (::pread(myFile, &record, sizeof(Record), offset) != sizeof(Record)) break;
+        long n = 3L * (record.x1 - record.x0) * (record.y1 - record.y0);
+        if (record.x1 < record.x0 || record.y1 < record.y0
+            || offset + (long) sizeof(Record) + n + 8 > file_size)
+            break;
+        pixels.resize(n);
+        std::uint64_t stored;
+        if (::pread(myFile, pixels.data(), n, offset + sizeof(Record)) != n
+            || ::pread(myFile, &stored, 8, offset + sizeof(Record) + n) != 8
+            || stored != hash(pixels.data(), n, hash(&record, sizeof(Record))))
+            break;
+        myRestored[record.index] = std::make_pair(record, offset + (long) sizeof(Record));
+        offset += (long) sizeof(Record) + n + 8;
+    }
+    return offset;
+}
+
+void
+rt::Checkpoint::close() {
+    if (myFile < 0) return;
+    flush();
+    if (myWriter.joinable()) myWriter.join();
+    ::close(myFile);
+    myFile = -1;
+    myRestored.clear();
+}
+
+bool
+rt::Checkpoint::restore(int index, int x0, int y0, int x1, int y1, std::vector<Color> &pixels) {
+    auto it = myRestored.find(index);
+    if (it == myRestored.end()) return false;
+    const Record &r = it->second.first;
+    if (r.x0 != x0 || r.y0 != y0 || r.x1 != x1 || r.y1 != y1) return false;
+    std::size_t n = (std::size_t) (x1 - x0) * (y1 - y0);
+    std::vector<unsigned char> bytes(3 * n);
+    if (::pread(myFile, bytes.data(), bytes.size(), it->second.second) != (ssize_t) bytes.size())
+        return false;
+    // Gives back the same bytes when converted as in Image2DWriter.
+    pixels.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+        pixels[i] = Color(bytes[3 * i] / 255.0f, bytes[3 * i + 1] / 255.0f, bytes[3 * i + 2] / 255.0f);
+    return true;
+}
+
+void
+rt::Checkpoint::add(int index, int x0, int y0, int x1, int y1, const Color *pixels) {
+    if (myFile < 0) return;
+    Record record = {index, x0, y0, x1, y1};
+    std::size_t n = (std::size_t) (x1 - x0) * (y1 - y0);
+    std::size_t begin = myPending.size();
+    myPending.resize(begin + sizeof(Record) + 3 * n + 8);
+    unsigned char *p = myPending.data() + begin;
+    std::memcpy(p, &record, sizeof(Record));
+    unsigned char *q = p + sizeof(Record);
+    for (std::size_t i = 0; i < n; ++i) RGB8(pixels[i]).toRGB8(q + 3 * i);
+    std::uint64_t h = hash(q, 3 * n, hash(&record, sizeof(Record)));
+    std::memcpy(q + 3 * n, &h, 8);
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - myLastFlush;
+    if (t.count() >= myPeriod) flush();
+}
+
+void
+rt::Checkpoint::flush() {
+    myLastFlush = std::chrono::steady_clock::now();
+    if (myPending.empty()) return;
+    // Only one write at a time, in order, so that records stay whole.
+    if (myWriter.joinable()) myWriter.join();
+    myWriting.swap(myPending);
+    myPending.clear();
+    int file = myFile;
+    std::vector<unsigned char> *data = &myWriting;
+    myWriter = std::thread([file, data]() {
+        const unsigned char *p = data->data();
+        std::size_t left = data->size();
+        while (left > 0) {
+            ssize_t written = ::write(file, p, left);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "[Checkpoint::flush] " << std::strerror(errno) << std::endl;
+                return;
+            }
+            p += written;
+            left -= written;
+        }
+        ::fsync(file);
+    });
+}
+
+std::uint64_t
+rt::Checkpoint::hash(const void *bytes, std::size_t n, std::uint64_t h) {
+    const unsigned char *p = (const unsigned char *) bytes;
+    for (std::size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
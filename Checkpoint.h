@@ -0,0 +1,109 @@
+/**
+@file Checkpoint.h
+*/
+#pragma once
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Color.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A file keeping the tiles already rendered of an image, so that a
+  /// render which is stopped can be resumed (see
+  /// WavefrontRenderer::setCheckpoint).
+  ///
+  /// The file is a header (size of the image and of the tiles, and a key
+  /// of the scene and the settings) followed by records, one per tile,
+  /// holding its pixels in 8 bits per channel (as they are written in
+  /// PPM images) and a checksum. Records are only appended: a record cut
+  /// by a crash is dropped when the file is opened again.
+  ///
+  /// Tiles are kept in memory and appended to the file every period
+  /// seconds by a thread, so that the renderer does not wait for the
+  /// disk.
+  struct Checkpoint {
+
+    Checkpoint() {}
+    /// Writes the last tiles and closes the file.
+    ~Checkpoint() { close(); }
+
+    /// Opens the checkpoint \a filename of an image of size \a width x
+    /// \a height cut in tiles of \a tile_size. When the file exists and
+    /// was written for the same image and the same \a key, its tiles are
+    /// restored, otherwise it is started again.
+    /// @return 'true' if it succeeded.
+    bool open( const std::string& filename, int width, int height, int tile_size,
+               std::uint64_t key );
+
+    /// Writes the last tiles and closes the file.
+    void close();
+
+    /// Sets the time between two writes of the file (30 s by default).
+    void setPeriod( double seconds ) { myPeriod = seconds; }
+
+    /// @return the number of tiles restored from the file.
+    std::size_t nbRestored() const { return myRestored.size(); }
+
+    /// Gets the tile \a index, of pixels [x0,x1[ x [y0,y1[, if it was
+    /// restored from the file.
+    /// @param[out] pixels its pixels, row by row.
+    /// @return 'true' if the tile was restored.
+    bool restore( int index, int x0, int y0, int x1, int y1, std::vector<Color>& pixels );
+
+    /// Adds the tile \a index, of pixels [x0,x1[ x [y0,y1[ given row by
+    /// row in \a pixels, and writes the file if the period is elapsed.
+    void add( int index, int x0, int y0, int x1, int y1, const Color* pixels );
+
+    /// Writes the tiles added since the last write, in a thread.
+    void flush();
+
+    /// @return the FNV-1a hash of \a bytes, continuing \a h.
+    static std::uint64_t hash( const void* bytes, std::size_t n,
+                               std::uint64_t h = 14695981039346656037ull );
+
+  private:
+    Checkpoint( const Checkpoint& ) = delete;
+    Checkpoint& operator=( const Checkpoint& ) = delete;
+
+    /// The header of the file.
+    struct Header {
+      char magic[ 4 ];
+      std::uint32_t version;
+      std::int32_t width, height, tile_size;
+      std::uint32_t padding;
+      std::uint64_t key;
+    };
+    /// The beginning of a record, followed by its pixels and the hash of
+    /// both.
+    struct Record {
+      std::int32_t index, x0, y0, x1, y1;
+    };
+
+    int myFile = -1;
+    /// The record of each restored tile, and the offset of its pixels in
+    /// the file.
+    std::unordered_map<int, std::pair<Record, long> > myRestored;
+    /// The records added since the last write, and the ones being
+    /// written by myWriter.
+    std::vector<unsigned char> myPending, myWriting;
+    std::thread myWriter;
+    double myPeriod = 30.0;
+    std::chrono::steady_clock::time_point myLastFlush;
+
+    /// Reads the records of the file, up to the last complete one.
+    /// @return the size of the valid part of the file.
+    long load( long file_size );
+  };
+
+} // namespace rt
+
+#endif // #define _CHECKPOINT_H_
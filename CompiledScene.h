@@ -0,0 +1,94 @@
+/**
+@file CompiledScene.h
+*/
+#pragma once
+#ifndef _COMPILED_SCENE_H_
+#define _COMPILED_SCENE_H_
+
+#include <cstdint>
+#include "Camera.h"
+#include "CameraPath.h"
+#include "SphereSet.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /**
+  Layout of a compiled scene file, i.e. a scene whose primitives,
+  material table and hierarchy are stored exactly as in memory, so that
+  it can be memory-mapped and rendered without any parsing or copy (see
+  CompiledSceneWriter and CompiledSceneReader). The file is:
+
+  - a CompiledSceneHeader,
+  - the lights (CompiledLight),
+  - the materials (Material),
+  - the spheres (SphereSet::Element),
+  - the nodes of the hierarchy (BVH<unsigned int>::Node),
+  - the keyframes of the camera (CameraPath::KeyFrame),
+
+  each array starting at an offset given in the header, multiple of
+  ALIGNMENT. Since the structures are stored raw, a file can only be
+  read on a machine with the same byte order and structure layout,
+  which the header records.
+  */
+  struct CompiledScene {
+    /// First bytes of every compiled scene file.
+    static const char* magic() { return "RTSCENE"; }
+    /// Incremented when the layout changes.
+    static const std::uint32_t VERSION = 3;
+    /// Arrays start at offsets multiple of this.
+    static const std::uint64_t ALIGNMENT = 64;
+    /// Written as is, and read back as ENDIANNESS only on machines with
+    /// the same byte order.
+    static const std::uint32_t ENDIANNESS = 0x01020304;
+
+    /// Value of CompiledSceneHeader::background.
+    enum BackgroundKind { NO_BACKGROUND = 0, BLACK_BACKGROUND = 1, BASIC_BACKGROUND = 2 };
+
+    typedef BVH<unsigned int>::Node Node;
+    typedef CameraPath::KeyFrame KeyFrame;
+
+    /// @return \a offset rounded up to the next multiple of ALIGNMENT.
+    static std::uint64_t align( std::uint64_t offset )
+    {
+      return ( offset + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+    }
+  };
+
+  /// A point light of a compiled scene.
+  struct CompiledLight {
+    /// The position of the light in homogeneous coordinates
+    Point4 position;
+    /// The emission color of the light.
+    Color emission;
+  };
+
+  /// The header of a compiled scene file.
+  struct CompiledSceneHeader {
+    /// CompiledScene::magic(), with its terminating 0.
+    char magic[ 8 ];
+    std::uint32_t version;
+    std::uint32_t endianness;
+    /// sizes of the stored structures, to detect incompatible layouts.
+    std::uint32_t light_size, material_size, element_size, node_size, keyframe_size;
+    /// 1 if the scene specifies a camera.
+    std::uint32_t has_camera;
+    /// a CompiledScene::BackgroundKind.
+    std::uint32_t background;
+    Camera camera;
+    std::uint32_t nb_lights;
+    std::uint32_t nb_materials;
+    std::uint64_t nb_elements;
+    std::int32_t nb_nodes;
+    /// the root node of the hierarchy (BVH::NONE if there are no spheres).
+    std::int32_t root;
+    std::uint32_t nb_keyframes;
+    /// offsets of the arrays from the beginning of the file.
+    std::uint64_t lights, materials, elements, nodes, keyframes;
+    /// total size of the file.
+    std::uint64_t size;
+  };
+
+} // namespace rt
+
+#endif // #define _COMPILED_SCENE_H_
@@ -0,0 +1,161 @@
+/**
+@file CompiledSceneReader.cpp
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CompiledSceneReader.h"
+#include "PointLight.h"
+
+namespace {
+    /// @return 'true' if the array of \a count items of size \a size at
+    /// \a offset lies in the file and is aligned.
+    bool inFile(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t file_size) {
+        return offset % rt::CompiledScene::ALIGNMENT == 0 && offset <= file_size
+               && count <= (file_size - offset) / size;
+    }
+}
+
+rt::CompiledSceneReader::CompiledSceneReader()
+        : hasCamera(false), background(0), hasBackground(false),
+          nbBytes(0), nbPrimitives(0), loadTime(0.0), myData(0), mySize(0) {}
+
+rt::CompiledSceneReader::~CompiledSceneReader() {
+    unmap();
+}
+
+bool
+rt::CompiledSceneReader::isCompiled(const std::string &filename) {
+    char magic[sizeof(CompiledSceneHeader::magic)] = {0};
+    std::ifstream input(filename.c_str(), std::ios::binary);
+    input.read(magic, sizeof(magic));
+    return input.good() && std::strcmp(magic, CompiledScene::magic()) == 0;
+}
+
+bool
+rt::CompiledSceneReader::read(Scene &scene, const std::string &filename) {
+    auto t0 = std::chrono::steady_clock::now();
+    unmap();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "CompiledSceneReader: unable to open " << filename << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (std::size_t) st.st_size < sizeof(CompiledSceneHeader)) {
+        std::cerr << "CompiledSceneReader: " << filename << " is not a compiled scene" << std::endl;
+        close(fd);
+        return false;
+    }
+    void *data = mmap(0, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid once the file is closed.
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "CompiledSceneReader: unable to map " << filename << std::endl;
+        return false;
+    }
+    myData = data;
+    mySize = (std::size_t) st.st_size;
+    const char *bytes = (const char *) myData;
+    const CompiledSceneHeader &header = *(const CompiledSceneHeader *) bytes;
+    if (!check(header)) {
+        unmap();
+        return false;
+    }
+
+    hasCamera = header.has_camera != 0;
+    if (hasCamera) camera = header.camera;
+    path = CameraPath();
+    const CompiledScene::KeyFrame *keyframes = (const CompiledScene::KeyFrame *) (bytes + header.keyframes);
+    for (std::uint32_t i = 0; i < header.nb_keyframes; ++i)
+        path.addKeyFrame(keyframes[i].time, keyframes[i].camera);
+    hasBackground = header.background != CompiledScene::NO_BACKGROUND;
+    background = header.background == CompiledScene::BASIC_BACKGROUND ? new BasicBackground : 0;
+    const CompiledLight *lights = (const CompiledLight *) (bytes + header.lights);
+    for (std::uint32_t i = 0; i < header.nb_lights; ++i)
+        scene.addLight(new PointLight(GL_LIGHT0 + i, lights[i].position, lights[i].emission));
+    if (header.nb_elements > 0) {
+        SphereSet *spheres = new SphereSet;
+        spheres->map((const SphereSet::Element *) (bytes + header.elements), header.nb_elements,
+                     (const Material *) (bytes + header.materials), header.nb_materials,
+                     (const CompiledScene::Node *) (bytes + header.nodes), header.nb_nodes, header.root);
+        scene.addObject(spheres);
+    }
+    nbBytes = mySize;
+    nbPrimitives = header.nb_lights + header.nb_elements;
+    loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
+
+void
+rt::CompiledSceneReader::displayStatistics(std::ostream &output) const {
+    output << "Mapped " << nbPrimitives << " primitives (" << nbBytes / 1e6 << " MB) in "
+           << loadTime << " s." << std::endl;
+}
+
+bool
+rt::CompiledSceneReader::check(const CompiledSceneHeader &header) const {
+    const char *error = 0;
+    if (std::strncmp(header.magic, CompiledScene::magic(), sizeof(header.magic)) != 0)
+        error = "not a compiled scene";
+    else if (header.version != CompiledScene::VERSION)
+        error = "unsupported version";
+    else if (header.endianness != CompiledScene::ENDIANNESS
+             || header.light_size != sizeof(CompiledLight)
+             || header.material_size != sizeof(Material)
+             || header.element_size != sizeof(SphereSet::Element)
+             || header.node_size != sizeof(CompiledScene::Node)
+             || header.keyframe_size != sizeof(CompiledScene::KeyFrame))
+        error = "compiled on an incompatible machine";
+    else if (header.size != mySize || header.nb_nodes < 0
+             || !inFile(header.lights, header.nb_lights, sizeof(CompiledLight), mySize)
+             || !inFile(header.materials, header.nb_materials, sizeof(Material), mySize)
+             || !inFile(header.elements, header.nb_elements, sizeof(SphereSet::Element), mySize)
+             || !inFile(header.nodes, (std::uint64_t) header.nb_nodes, sizeof(CompiledScene::Node), mySize)
+             || !inFile(header.keyframes, header.nb_keyframes, sizeof(CompiledScene::KeyFrame), mySize))
+        error = "truncated or corrupted file";
+    else if (header.nb_elements > 0 && (header.root < 0 || header.root >= header.nb_nodes))
+        error = "invalid hierarchy";
+    else if (!checkArrays(header))
+        error = "truncated or corrupted file";
+    if (error == 0) return true;
+    std::cerr << "CompiledSceneReader: " << error << std::endl;
+    return false;
+}
+
+bool
+rt::CompiledSceneReader::checkArrays(const CompiledSceneHeader &header) const {
+    const char *bytes = (const char *) myData;
+    const SphereSet::Element *elements = (const SphereSet::Element *) (bytes + header.elements);
+    for (std::uint64_t i = 0; i < header.nb_elements; ++i)
+        if (elements[i].material >= header.nb_materials) return false;
+    if (header.nb_elements == 0) return true;
+    // Children always follow their parent in a built hierarchy, which
+    // rules out cycles, and the heights are checked from the leaves up
+    // so that traversals cannot overflow their stack.
+    const CompiledScene::Node *nodes = (const CompiledScene::Node *) (bytes + header.nodes);
+    for (std::int32_t i = header.nb_nodes - 1; i >= 0; --i) {
+        const CompiledScene::Node &node = nodes[i];
+        if (node.left == BVH<unsigned int>::NONE) {
+            if (node.right != BVH<unsigned int>::NONE || node.item >= header.nb_elements
+                || node.height != 0)
+                return false;
+        } else if (node.left <= i || node.left >= header.nb_nodes
+                   || node.right <= i || node.right >= header.nb_nodes
+                   || node.height != 1 + std::max(nodes[node.left].height, nodes[node.right].height))
+            return false;
+    }
+    return nodes[header.root].height < BVH<unsigned int>::MAX_HEIGHT;
+}
+
+void
+rt::CompiledSceneReader::unmap() {
+    if (myData != 0) munmap(myData, mySize);
+    myData = 0;
+    mySize = 0;
+}
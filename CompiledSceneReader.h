@@ -0,0 +1,84 @@
+/**
+@file CompiledSceneReader.h
+*/
+#pragma once
+#ifndef _COMPILED_SCENE_READER_H_
+#define _COMPILED_SCENE_READER_H_
+
+#include <iostream>
+#include <string>
+#include "CompiledScene.h"
+#include "Scene.h"
+#include "Background.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /**
+  Reads a compiled scene file (see CompiledScene) by mapping it in
+  memory. Nothing is parsed nor copied: the SphereSet added to the scene
+  renders directly from the mapped spheres, materials and hierarchy. The
+  indices they hold are checked once, so that a corrupted file is
+  rejected instead of crashing the renderer, which costs a pass over
+  the spheres and the nodes.
+
+  @note The reader owns the mapping, hence it must outlive the scene
+  (or at least the renderings of the scene).
+  */
+  struct CompiledSceneReader {
+    /// The camera of the file (valid if hasCamera).
+    Camera camera;
+    /// 'true' when the file specifies a camera.
+    bool hasCamera;
+    /// The path of the camera given by the keyframes of the file.
+    CameraPath path;
+    /// The background of the file (valid if hasBackground, 0 means
+    /// black). The caller is responsible for its deallocation.
+    Background* background;
+    /// 'true' when the file specifies a background.
+    bool hasBackground;
+
+    /// Size of the mapped file.
+    std::size_t nbBytes;
+    /// Number of primitives (spheres, lights) of the file.
+    std::size_t nbPrimitives;
+    /// Time spent to map the file (in seconds).
+    double loadTime;
+
+    /// Default constructor.
+    CompiledSceneReader();
+    /// Destructor. Unmaps the file.
+    ~CompiledSceneReader();
+
+    /// @return 'true' if \a filename starts like a compiled scene file.
+    static bool isCompiled( const std::string& filename );
+
+    /// Maps the compiled scene file \a filename and adds its content to
+    /// \a scene.
+    /// @return 'true' if everything went well, otherwise an error is
+    /// displayed on std::cerr.
+    bool read( Scene& scene, const std::string& filename );
+
+    /// Displays the statistics of the last read.
+    void displayStatistics( std::ostream& output ) const;
+
+  private:
+    /// The mapped file (0 if none).
+    void* myData;
+    std::size_t mySize;
+
+    /// Checks that the header describes a file that can be used here.
+    bool check( const CompiledSceneHeader& header ) const;
+    /// Checks that the material of every sphere and the children and
+    /// items of every node are valid indices, in one pass over them.
+    bool checkArrays( const CompiledSceneHeader& header ) const;
+    void unmap();
+
+    // The mapping cannot be shared.
+    CompiledSceneReader( const CompiledSceneReader& );
+    CompiledSceneReader& operator=( const CompiledSceneReader& );
+  };
+
+} // namespace rt
+
+#endif // #define _COMPILED_SCENE_READER_H_
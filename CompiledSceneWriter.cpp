@@ -0,0 +1,104 @@
+/**
+@file CompiledSceneWriter.cpp
+*/
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <typeinfo>
+#include "CompiledSceneWriter.h"
+#include "PointLight.h"
+
+namespace {
+    /// Writes \a size bytes, after zeros up to \a offset.
+    void writeAt(std::ofstream &output, std::uint64_t offset, const void *data, std::size_t size) {
+        static const char zeros[rt::CompiledScene::ALIGNMENT] = {0};
+        for (std::uint64_t position = (std::uint64_t) output.tellp(); position < offset;
+             position += sizeof(zeros))
+            output.write(zeros, (std::streamsize) std::min<std::uint64_t>(offset - position, sizeof(zeros)));
+        output.write((const char *) data, (std::streamsize) size);
+    }
+}
+
+bool
+rt::CompiledSceneWriter::write(const std::string &filename,
+                               const SphereSet &spheres,
+                               const std::vector<Light *> &lights,
+                               const Camera *camera,
+                               const CameraPath &path,
+                               bool has_background, const Background *background) {
+    std::vector<CompiledLight> compiled_lights;
+    for (Light *light : lights) {
+        PointLight *point_light = dynamic_cast<PointLight *>(light);
+        if (point_light == 0 || light->hasArea()) {
+            std::cerr << "CompiledSceneWriter: only point lights can be stored." << std::endl;
+            return false;
+        }
+        CompiledLight cl;
+        cl.position = point_light->position;
+        cl.emission = point_light->emission;
+        compiled_lights.push_back(cl);
+    }
+
+    CompiledSceneHeader header;
+    // Clears the padding too, so that files are reproducible.
+    std::memset((void *) &header, 0, sizeof(header));
+    std::strcpy(header.magic, CompiledScene::magic());
+    header.version = CompiledScene::VERSION;
+    header.endianness = CompiledScene::ENDIANNESS;
+    header.light_size = sizeof(CompiledLight);
+    header.material_size = sizeof(Material);
+    header.element_size = sizeof(SphereSet::Element);
+    header.node_size = sizeof(CompiledScene::Node);
+    header.keyframe_size = sizeof(CompiledScene::KeyFrame);
+    header.has_camera = camera != 0 ? 1 : 0;
+    header.camera = camera != 0 ? *camera : Camera();
+    if (!has_background)
+        header.background = CompiledScene::NO_BACKGROUND;
+    else if (background == 0)
+        header.background = CompiledScene::BLACK_BACKGROUND;
+    else if (typeid(*background) == typeid(BasicBackground))
+        header.background = CompiledScene::BASIC_BACKGROUND;
+    else {
+        std::cerr << "CompiledSceneWriter: this background cannot be stored." << std::endl;
+        return false;
+    }
+    const BVH<unsigned int> &index = spheres.index();
+    header.nb_lights = (std::uint32_t) compiled_lights.size();
+    header.nb_materials = (std::uint32_t) spheres.nbMaterials();
+    header.nb_elements = spheres.nbElements();
+    header.nb_nodes = header.nb_elements > 0 ? index.nbNodes() : 0;
+    header.root = header.nb_elements > 0 ? index.root() : BVH<unsigned int>::NONE;
+    header.nb_keyframes = (std::uint32_t) path.nbKeyFrames();
+    header.lights = CompiledScene::align(sizeof(header));
+    header.materials = CompiledScene::align(header.lights + header.nb_lights * sizeof(CompiledLight));
+    header.elements = CompiledScene::align(header.materials + header.nb_materials * sizeof(Material));
+    header.nodes = CompiledScene::align(header.elements + header.nb_elements * sizeof(SphereSet::Element));
+    header.keyframes = CompiledScene::align(header.nodes + header.nb_nodes * sizeof(CompiledScene::Node));
+    header.size = header.keyframes + header.nb_keyframes * sizeof(CompiledScene::KeyFrame);
+
+    std::ofstream output(filename.c_str(), std::ios::binary);
+    if (!output.good()) {
+        std::cerr << "CompiledSceneWriter: unable to open " << filename << std::endl;
+        return false;
+    }
+    writeAt(output, 0, &header, sizeof(header));
+    writeAt(output, header.lights, compiled_lights.data(), header.nb_lights * sizeof(CompiledLight));
+    if (header.nb_materials > 0)
+        writeAt(output, header.materials, &spheres.material(0), header.nb_materials * sizeof(Material));
+    if (header.nb_elements > 0) {
+        writeAt(output, header.elements, &spheres.element(0),
+                header.nb_elements * sizeof(SphereSet::Element));
+        writeAt(output, header.nodes, index.data(), header.nb_nodes * sizeof(CompiledScene::Node));
+    }
+    for (int i = 0; i < path.nbKeyFrames(); ++i)
+        writeAt(output, header.keyframes + i * sizeof(CompiledScene::KeyFrame), &path.keyFrame(i),
+                sizeof(CompiledScene::KeyFrame));
+    writeAt(output, header.size, 0, 0);
+    output.close();
+    if (!output.good()) {
+        std::cerr << "CompiledSceneWriter: error while writing " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
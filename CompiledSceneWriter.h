@@ -0,0 +1,38 @@
+/**
+@file CompiledSceneWriter.h
+*/
+#pragma once
+#ifndef _COMPILED_SCENE_WRITER_H_
+#define _COMPILED_SCENE_WRITER_H_
+
+#include <string>
+#include <vector>
+#include "CompiledScene.h"
+#include "Background.h"
+#include "Light.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Writes a compiled scene file (see CompiledScene), typically once
+  /// after reading a text scene with SceneReader, so that later renders
+  /// can start from CompiledSceneReader.
+  struct CompiledSceneWriter {
+    /// Writes the indexed set of spheres \a spheres, the point lights
+    /// \a lights, the camera \a camera (if not 0), the keyframes of \a
+    /// path and the background \a background (if \a has_background, 0
+    /// means black) into the file \a filename.
+    /// @return 'true' if everything went well, otherwise an error is
+    /// displayed on std::cerr (for instance if a light or the background
+    /// cannot be stored).
+    static bool write( const std::string& filename,
+                       const SphereSet& spheres,
+                       const std::vector<Light*>& lights,
+                       const Camera* camera,
+                       const CameraPath& path,
+                       bool has_background, const Background* background );
+  };
+
+} // namespace rt
+
+#endif // #define _COMPILED_SCENE_WRITER_H_
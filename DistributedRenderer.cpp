@@ -0,0 +1,263 @@
+/**
+@file DistributedRenderer.cpp
+*/
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "DistributedRenderer.h"
+
+namespace {
+    /// What a worker sends back before the colors of a tile: its bounds
+    /// and the statistics of its rendering.
+    struct Reply {
+        int x0, y0, x1, y1;
+        long secondary_rays;
+        double intersection_time, sort_time;
+    };
+}
+
+void
+rt::DistributedRenderer::render(TileSink &sink, int max_depth) {
+    beginTiles();
+    std::vector<Tile> tiles;
+    regionTiles(tiles);
+    std::vector<char> done(tiles.size(), 0);
+    // Number of workers rendering each tile.
+    std::vector<int> copies(tiles.size(), 0);
+    std::deque<int> todo;
+    std::size_t nb_done = 0;
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        const Tile &t = tiles[i];
+        if (restoreTile(t)) {
+            sink.writeTile(t.x0, t.y0, t.x1, t.y1, myTile.data(), ptrMask != 0 ? myTileRendered.data() : 0);
+            done[i] = 1;
+            ++nb_done;
+        } else
+            todo.push_back((int) i);
+    }
+    if (!todo.empty()) startWorkers(max_depth);
+    double tile_time = 0.0;
+    long nb_timed = 0;
+    std::vector<pollfd> fds;
+    std::vector<Worker *> polled;
+    while (nb_done < tiles.size()) {
+        progressBar(std::cout, (Real) nb_done / (Real) tiles.size(), 1.0);
+        auto now = std::chrono::steady_clock::now();
+        // Gives a tile to each idle worker: the next one, or else a tile
+        // which is much longer than the other ones.
+        for (Worker &w : myWorkers) {
+            if (w.socket < 0 || w.tile >= 0) continue;
+            while (!todo.empty() && done[todo.front()]) todo.pop_front();
+            int tile = -1;
+            if (!todo.empty()) {
+                tile = todo.front();
+                todo.pop_front();
+            } else if (nb_timed > 0) {
+                double oldest = 2.0 * tile_time / nb_timed;
+                for (const Worker &o : myWorkers) {
+                    if (o.socket < 0 || o.tile < 0 || copies[o.tile] != 1) continue;
+                    double age = std::chrono::duration<double>(now - o.start).count();
+                    if (age > oldest) {
+                        oldest = age;
+                        tile = o.tile;
+                    }
+                }
+            }
+            if (tile < 0) continue;
+            if (assign(w, tiles, tile)) ++copies[tile];
+            else if (copies[tile] == 0) todo.push_front(tile);
+        }
+        fds.clear();
+        polled.clear();
+        for (Worker &w : myWorkers)
+            if (w.socket >= 0 && w.tile >= 0) {
+                pollfd fd = {w.socket, POLLIN, 0};
+                fds.push_back(fd);
+                polled.push_back(&w);
+            }
+        if (fds.empty()) {
+            // All workers are dead: the remaining tiles are rendered here.
+            std::cerr << "[DistributedRenderer::render] No worker left, rendering locally." << std::endl;
+            for (std::size_t i = 0; i < tiles.size(); ++i) {
+                if (done[i]) continue;
+                const Tile &t = tiles[i];
+                renderTile(t.x0, t.y0, t.x1, t.y1, max_depth);
+                if (ptrCheckpoint != 0) ptrCheckpoint->add(t.index, t.x0, t.y0, t.x1, t.y1, myTile.data());
+                sink.writeTile(t.x0, t.y0, t.x1, t.y1, myTile.data(), ptrMask != 0 ? myTileRendered.data() : 0);
+                done[i] = 1;
+                ++nb_done;
+            }
+            break;
+        }
+        // Wakes up regularly to give long tiles to idle workers.
+        if (::poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR) {
+            std::cerr << "[DistributedRenderer::render] poll: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (std::size_t k = 0; k < fds.size(); ++k) {
+            if (fds[k].revents == 0) continue;
+            Worker &w = *polled[k];
+            int tile = w.tile;
+            const Tile &t = tiles[tile];
+            if (!receive(w)) {
+                std::cerr << "[DistributedRenderer::render] Worker " << w.pid << " died." << std::endl;
+                kill(w);
+                if (--copies[tile] == 0 && !done[tile]) todo.push_front(tile);
+                continue;
+            }
+            // The rest of the reply comes later.
+            if (w.received < w.reply.size()) continue;
+            Reply reply;
+            std::memcpy(&reply, w.reply.data(), sizeof(Reply));
+            myTile.resize((std::size_t) (t.x1 - t.x0) * (t.y1 - t.y0));
+            std::memcpy(myTile.data(), w.reply.data() + sizeof(Reply), myTile.size() * sizeof(Color));
+            --copies[tile];
+            w.tile = -1;
+            tile_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - w.start).count();
+            ++nb_timed;
+            if (done[tile]) continue; // already given by another worker
+            mySecondaryRays += reply.secondary_rays;
+            myIntersectionTime += reply.intersection_time;
+            mySortTime += reply.sort_time;
+            maskTile(t.x0, t.y0, t.x1, t.y1);
+            if (ptrCheckpoint != 0) ptrCheckpoint->add(t.index, t.x0, t.y0, t.x1, t.y1, myTile.data());
+            sink.writeTile(t.x0, t.y0, t.x1, t.y1, myTile.data(), ptrMask != 0 ? myTileRendered.data() : 0);
+            done[tile] = 1;
+            ++nb_done;
+        }
+    }
+    stopWorkers();
+    endTiles();
+}
+
+void
+rt::DistributedRenderer::startWorkers(int max_depth) {
+    stopWorkers();
+    // Buffered output would be written again by each worker.
+    std::cout.flush();
+    std::cerr.flush();
+    for (int i = 0; i < myNbWorkers; ++i) {
+        int sockets[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+            std::cerr << "[DistributedRenderer::startWorkers] socketpair: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            std::cerr << "[DistributedRenderer::startWorkers] fork: " << std::strerror(errno) << std::endl;
+            ::close(sockets[0]);
+            ::close(sockets[1]);
+            break;
+        }
+        if (pid == 0) {
+            // The worker only keeps its own socket, so that the other
+            // workers see the end of theirs when this process closes it.
+            ::close(sockets[0]);
+            for (Worker &w : myWorkers) ::close(w.socket);
+            work(sockets[1], max_depth);
+            ::_exit(0);
+        }
+        ::close(sockets[1]);
+        Worker w;
+        w.pid = pid;
+        w.socket = sockets[0];
+        w.tile = -1;
+        w.received = 0;
+        myWorkers.push_back(w);
+    }
+    std::cout << myWorkers.size() << " workers started." << std::endl;
+}
+
+void
+rt::DistributedRenderer::stopWorkers() {
+    for (Worker &w : myWorkers) {
+        // A busy worker may be stopped or very slow.
+        if (w.socket >= 0 && w.tile >= 0) ::kill(w.pid, SIGKILL);
+        if (w.socket >= 0) ::close(w.socket);
+        ::waitpid(w.pid, 0, 0);
+    }
+    myWorkers.clear();
+}
+
+void
+rt::DistributedRenderer::work(int socket, int max_depth) {
+    Tile t;
+    while (readAll(socket, &t, sizeof(Tile))) {
+        long rays = mySecondaryRays;
+        double intersection_time = myIntersectionTime, sort_time = mySortTime;
+        renderTile(t.x0, t.y0, t.x1, t.y1, max_depth);
+        Reply reply = {t.x0, t.y0, t.x1, t.y1, mySecondaryRays - rays,
+                       myIntersectionTime - intersection_time, mySortTime - sort_time};
+        if (!writeAll(socket, &reply, sizeof(Reply))
+            || !writeAll(socket, myTile.data(), myTile.size() * sizeof(Color)))
+            break;
+    }
+    ::close(socket);
+}
+
+bool
+rt::DistributedRenderer::assign(Worker &w, const std::vector<Tile> &tiles, int tile) {
+    if (!writeAll(w.socket, &tiles[tile], sizeof(Tile))) {
+        std::cerr << "[DistributedRenderer::assign] Worker " << w.pid << " died." << std::endl;
+        kill(w);
+        return false;
+    }
+    const Tile &t = tiles[tile];
+    w.tile = tile;
+    w.start = std::chrono::steady_clock::now();
+    w.reply.resize(sizeof(Reply) + (std::size_t) (t.x1 - t.x0) * (t.y1 - t.y0) * sizeof(Color));
+    w.received = 0;
+    return true;
+}
+
+void
+rt::DistributedRenderer::kill(Worker &w) {
+    ::kill(w.pid, SIGKILL);
+    ::close(w.socket);
+    w.socket = -1;
+    w.tile = -1;
+}
+
+bool
+rt::DistributedRenderer::receive(Worker &w) {
+    while (w.received < w.reply.size()) {
+        ssize_t r = ::recv(w.socket, w.reply.data() + w.received, w.reply.size() - w.received, MSG_DONTWAIT);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (r <= 0) return false;
+        w.received += r;
+    }
+    return true;
+}
+
+bool
+rt::DistributedRenderer::readAll(int socket, void *data, std::size_t n) {
+    char *p = (char *) data;
+    while (n > 0) {
+        ssize_t r = ::recv(socket, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+bool
+rt::DistributedRenderer::writeAll(int socket, const void *data, std::size_t n) {
+    const char *p = (const char *) data;
+    while (n > 0) {
+        // No SIGPIPE when the other process is dead.
+        ssize_t r = ::send(socket, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/**
+@file DistributedRenderer.h
+*/
+#pragma once
+#ifndef _DISTRIBUTED_RENDERER_H_
+#define _DISTRIBUTED_RENDERER_H_
+
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <sys/types.h>
+#include "WavefrontRenderer.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A renderer splitting the image in tiles rendered by worker
+  /// processes. The workers are forked at the beginning of render, so
+  /// that they share the scene loaded by this process, and each one
+  /// talks with it through a Unix domain socket: it receives the bounds
+  /// of a tile, renders it as WavefrontRenderer does, and sends back its
+  /// colors. Images are thus the same as the ones of WavefrontRenderer.
+  /// The statistics of the tiles are sent back too: the times displayed
+  /// at the end are summed over the workers.
+  ///
+  /// Tiles are given one by one to idle workers, so that fast workers
+  /// render more tiles. The tile of a worker which dies is given to
+  /// another one. When no tile is left to give, the tiles taking more
+  /// than twice the average time of a tile are given to idle workers
+  /// too, and the first result is kept. Tiles are thus written into the
+  /// sink as they are finished. Replies are received without blocking,
+  /// so that a worker stalled in the middle of one does not hold up the
+  /// other ones. If all workers die, the remaining tiles are rendered by
+  /// this process.
+  struct DistributedRenderer : public WavefrontRenderer {
+
+    DistributedRenderer( int nb_workers ) : WavefrontRenderer(), myNbWorkers( nb_workers ) {}
+    DistributedRenderer( Scene& scene, int nb_workers )
+      : WavefrontRenderer( scene ), myNbWorkers( nb_workers ) {}
+    /// Stops the workers (if any).
+    ~DistributedRenderer() { stopWorkers(); }
+
+    using WavefrontRenderer::render;
+    /// Renders the image with the workers, tile by tile into \a sink.
+    void render( TileSink& sink, int max_depth );
+
+  protected:
+    /// A worker process.
+    struct Worker {
+      pid_t pid;
+      /// the socket connected to the worker (-1 once it is dead)
+      int socket;
+      /// the tile being rendered by the worker (index in the tiles of
+      /// render), or -1 when it is idle
+      int tile;
+      /// when the tile was given
+      std::chrono::steady_clock::time_point start;
+      /// the reply for the tile (header and colors), and the number of
+      /// its bytes received so far
+      std::vector<char> reply;
+      std::size_t received;
+    };
+
+    int myNbWorkers;
+    std::vector<Worker> myWorkers;
+
+    /// Forks the workers.
+    void startWorkers( int max_depth );
+    /// Closes the sockets of the workers and waits for their end.
+    void stopWorkers();
+    /// The loop of a worker: renders the tiles received on \a socket.
+    void work( int socket, int max_depth );
+    /// Gives the tile \a tile of \a tiles to the worker \a w.
+    /// @return 'false' if the worker is dead.
+    bool assign( Worker& w, const std::vector<Tile>& tiles, int tile );
+    /// Marks the worker \a w as dead.
+    void kill( Worker& w );
+    /// Receives the bytes of the reply of \a w available on its socket,
+    /// without waiting for the other ones.
+    /// @return 'false' if the socket was closed or failed.
+    static bool receive( Worker& w );
+
+    /// Reads or writes \a n bytes on \a socket.
+    /// @return 'false' if the socket was closed or failed.
+    static bool readAll( int socket, void* data, std::size_t n );
+    static bool writeAll( int socket, const void* data, std::size_t n );
+  };
+
+} // namespace rt
+
+#endif // #define _DISTRIBUTED_RENDERER_H_
@@ -0,0 +1,118 @@
+/**
+@file EnvironmentMap.cpp
+*/
+#include <algorithm>
+#include <cmath>
+#include "EnvironmentMap.h"
+
+rt::EnvironmentMap::EnvironmentMap(int size)
+        : mySize(std::max(size, 1)), myTexels(6 * (std::size_t) mySize * mySize) {}
+
+template <typename Function>
+void
+rt::EnvironmentMap::bake(Function f, int samples, const Vector3 &axis, Real min_cos) {
+    samples = std::max(samples, 1);
+    Real weight = 1.0f / (samples * samples);
+    for (int face = 0; face < 6; ++face)
+        for (int j = 0; j < mySize; ++j)
+            for (int i = 0; i < mySize; ++i) {
+                Vector3 center = direction(face, 2.0f * (i + 0.5f) / mySize - 1.0f,
+                                           2.0f * (j + 0.5f) / mySize - 1.0f);
+                if (center.dot(axis) < min_cos) continue;
+                Color c(0, 0, 0);
+                for (int sj = 0; sj < samples; ++sj)
+                    for (int si = 0; si < samples; ++si) {
+                        Real u = 2.0f * (i + (si + 0.5f) / samples) / mySize - 1.0f;
+                        Real v = 2.0f * (j + (sj + 0.5f) / samples) / mySize - 1.0f;
+                        c += f(direction(face, u, v));
+                    }
+                myTexels[((std::size_t) face * mySize + j) * mySize + i] += c * weight;
+            }
+}
+
+void
+rt::EnvironmentMap::add(Background &source, int samples) {
+    bake([&source](const Vector3 &d) {
+        return source.backgroundColor(Ray(Point3(0, 0, 0), d));
+    }, samples, Vector3(0, 0, 0), -1.0f);
+}
+
+bool
+rt::EnvironmentMap::addLight(const Light &light, int samples) {
+    if (!light.isAtInfinity()) return false;
+    // Same disc as Renderer::background.
+    Vector3 l = light.direction(Point3(0, 0, 0));
+    Color c = light.color(Point3(0, 0, 0));
+    // Only the texels close to the disc are visited (a texel is seen
+    // under less than 2/size radians).
+    Real min_cos = cos(acos(0.99f) + 2.0f / mySize);
+    bake([&l, &c](const Vector3 &d) {
+        Real cos_a = l.dot(d);
+        return cos_a > 0.99f ? c * Light::discIntensity(cos_a) : Color(0, 0, 0);
+    }, samples, l, min_cos);
+    myLights.push_back(&light);
+    return true;
+}
+
+bool
+rt::EnvironmentMap::includesLight(const Light *light) const {
+    return std::find(myLights.begin(), myLights.end(), light) != myLights.end();
+}
+
+rt::Color
+rt::EnvironmentMap::backgroundColor(const Ray &ray) {
+    const Vector3 &d = ray.direction;
+    Real ax = std::fabs(d[0]), ay = std::fabs(d[1]), az = std::fabs(d[2]);
+    // The largest coordinate gives the face, the two others its (u,v).
+    int face;
+    Real u, v, m;
+    if (ax >= ay && ax >= az) {
+        face = d[0] >= 0.0f ? 0 : 1;
+        u = d[1];
+        v = d[2];
+        m = ax;
+    } else if (ay >= az) {
+        face = d[1] >= 0.0f ? 2 : 3;
+        u = d[2];
+        v = d[0];
+        m = ay;
+    } else {
+        face = d[2] >= 0.0f ? 4 : 5;
+        u = d[0];
+        v = d[1];
+        m = az;
+    }
+    if (m == 0.0f) return Color(0, 0, 0);
+    // Texel centers are at integer coordinates.
+    Real half = 0.5f * mySize / m;
+    Real x = std::max(0.0f, std::min(u * half + 0.5f * mySize - 0.5f, (Real) (mySize - 1)));
+    Real y = std::max(0.0f, std::min(v * half + 0.5f * mySize - 0.5f, (Real) (mySize - 1)));
+    int i = (int) x, j = (int) y;
+    int di = i + 1 < mySize ? 1 : 0, dj = j + 1 < mySize ? mySize : 0;
+    Real fx = x - i, fy = y - j;
+    const Color *t = &myTexels[((std::size_t) face * mySize + j) * mySize + i];
+    const float *c00 = t[0], *c10 = t[di], *c01 = t[dj], *c11 = t[dj + di];
+    Real w00 = (1.0f - fx) * (1.0f - fy), w10 = fx * (1.0f - fy);
+    Real w01 = (1.0f - fx) * fy, w11 = fx * fy;
+    Color c;
+    for (int k = 0; k < 3; ++k)
+        c[k] = w00 * c00[k] + w10 * c10[k] + w01 * c01[k] + w11 * c11[k];
+    return c;
+}
+
+rt::Vector3
+rt::EnvironmentMap::direction(int face, Real u, Real v) {
+    Real s = face % 2 == 0 ? 1.0f : -1.0f;
+    Vector3 d;
+    switch (face / 2) {
+        case 0:
+            d = Vector3(s, u, v);
+            break;
+        case 1:
+            d = Vector3(v, s, u);
+            break;
+        default:
+            d = Vector3(u, v, s);
+    }
+    return d / d.norm();
+}
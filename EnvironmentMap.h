@@ -0,0 +1,69 @@
+/**
+@file EnvironmentMap.h
+*/
+#pragma once
+#ifndef _ENVIRONMENT_MAP_H_
+#define _ENVIRONMENT_MAP_H_
+
+#include <vector>
+#include "Background.h"
+#include "Light.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A background precomputed into a cube map: each of the 6 faces of
+  /// the cube [-1,1]^3 is a table of size x size colors, filled once by
+  /// evaluating other backgrounds (sky, floor) and the discs of the
+  /// lights at infinity. A ray that hits no object then costs one
+  /// division and a bilinear interpolation in one face, whatever the
+  /// backgrounds and the number of lights folded in the table.
+  ///
+  /// Since the table only depends on the direction of the ray, it
+  /// cannot hold the discs of lights at finite distance (they are still
+  /// displayed by Renderer::background), and details smaller than a
+  /// texel (e.g. the checkerboard close to the horizon) are averaged.
+  struct EnvironmentMap : public Background {
+
+    /// Creates a black map whose faces have \a size x \a size texels.
+    EnvironmentMap( int size = 512 );
+
+    /// Adds the background \a source to the table, each texel being the
+    /// average of \a samples x \a samples directions.
+    void add( Background& source, int samples = 2 );
+
+    /// Adds the disc of \a light to the table (as Renderer::background
+    /// would display it), if the light is at infinity.
+    /// @return 'true' if it was added.
+    bool addLight( const Light& light, int samples = 2 );
+
+    /// @return the color of the table in the direction of \a ray.
+    Color backgroundColor( const Ray& ray );
+
+    /// @return 'true' if \a light was added to the table.
+    bool includesLight( const Light* light ) const;
+
+    /// @return the number of texels along a side of a face.
+    int size() const { return mySize; }
+
+  protected:
+    int mySize;
+    /// the faces +x, -x, +y, -y, +z, -z, stored one after the other,
+    /// row by row.
+    std::vector<Color> myTexels;
+    /// the lights added to the table.
+    std::vector<const Light*> myLights;
+
+    /// @return the direction of the point (u,v) in [-1,1]^2 of \a face.
+    static Vector3 direction( int face, Real u, Real v );
+
+    /// Adds to each texel the average of \a f over \a samples x \a
+    /// samples directions of the texel. Texels whose center makes a
+    /// cosine smaller than \a min_cos with \a axis are skipped.
+    template <typename Function>
+    void bake( Function f, int samples, const Vector3& axis, Real min_cos );
+  };
+
+} // namespace rt
+
+#endif // #define _ENVIRONMENT_MAP_H_
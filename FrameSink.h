@@ -0,0 +1,53 @@
+/**
+@file FrameSink.h
+*/
+#pragma once
+#ifndef _FRAME_SINK_H_
+#define _FRAME_SINK_H_
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Color.h"
+#include "Image2D.h"
+#include "Image2DWriter.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Receives the frames of an animation as they are rendered (see
+  /// SequenceRenderer). Frames come in order, one at a time, but from
+  /// another thread than the one rendering.
+  struct FrameSink {
+    virtual ~FrameSink() {}
+
+    /// Writes the frame number \a frame.
+    /// @return 'true' if it succeeded.
+    virtual bool writeFrame( int frame, Image2D<Color>& image ) = 0;
+  };
+
+  /// A sink writing each frame into its own PPM image, whose name is
+  /// given by a printf pattern of the frame number (e.g. "frame%04d.ppm").
+  struct PPMFrameSink : public FrameSink {
+    std::string pattern;
+
+    PPMFrameSink( const std::string& name_pattern ) : pattern( name_pattern ) {}
+
+    bool writeFrame( int frame, Image2D<Color>& image )
+    {
+      char filename[ 4096 ];
+      std::snprintf( filename, sizeof( filename ), pattern.c_str(), frame );
+      std::ofstream output( filename, std::ios::binary );
+      if ( ! Image2DWriter<Color>::write( image, output, false ) || ! output.good() )
+        {
+          std::cerr << "[PPMFrameSink::writeFrame] Unable to write " << filename << std::endl;
+          return false;
+        }
+      return true;
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _FRAME_SINK_H_
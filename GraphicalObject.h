@@ -11,10 +11,25 @@
 #include "PointVector.h"
 #include "Material.h"
 #include "Ray.h"
+#include "BoundingBox.h"
 
 /// Namespace RayTracer
 namespace rt {
 
+  /// Stores what is needed to shade the point where a ray hits an
+  /// object. It is filled by GraphicalObject::rayIntersection.
+  struct RayHit {
+    /// the point of intersection
+    Point3 point;
+    /// the normal vector to the object at this point
+    Vector3 normal;
+    /// the material of the object at this point
+    Material material;
+    /// the index of the primitive hit when the object is made of
+    /// several primitives (0 otherwise).
+    unsigned int primitive;
+  };
+
   /// This is an interface specifying methods that any graphical
   /// object should have. It is also drawable to be seen in QGLViewer
   /// window.
@@ -50,7 +65,43 @@ namespace rt {
     /// @return either a real < 0.0 if there is an intersection, or a
     /// kind of distance to the closest point of intersection.
     virtual Real rayIntersection( const Ray& ray, Point3& p ) = 0;
-                    
+
+    /// Same as rayIntersection( ray, p ), but when there is an
+    /// intersection, \a hit also receives the normal and the material
+    /// at the point of intersection. Objects made of several
+    /// primitives (sets of spheres, meshes) must override it, since the
+    /// primitive hit cannot be recovered from the point alone.
+    virtual Real rayIntersection( const Ray& ray, RayHit& hit )
+    {
+      Real d = rayIntersection( ray, hit.point );
+      if ( d <= 0.0f ) {
+        hit.normal    = getNormal( hit.point );
+        hit.material  = getMaterial( hit.point );
+        hit.primitive = 0;
+      }
+      return d;
+    }
+
+    /// Same as rayIntersection( ray, hit ), but only the primitive \a
+    /// primitive of the object (as given by hit.primitive) is
+    /// tested. It is much cheaper for objects made of many primitives,
+    /// and is used to test again an object known to hide a light (see
+    /// Renderer::shadow).
+    virtual Real primitiveIntersection( const Ray& ray, unsigned int /* primitive */,
+                                        RayHit& hit )
+    {
+      return rayIntersection( ray, hit );
+    }
+
+    /// @return 'true' if no light goes through any part of the object
+    /// (see Material::isOpaque). The default answer is the safe one.
+    virtual bool isOpaque() { return false; }
+
+    /// @return a box containing the object. Objects that are not
+    /// bounded (like infinite planes) keep the default infinite box, and
+    /// are then tested against every ray.
+    virtual BoundingBox getBoundingBox() { return BoundingBox::infinite(); }
+
 
   };
 
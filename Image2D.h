@@ -1,16 +1,65 @@
 // file Image2D.hpp
 #ifndef _IMAGE2D_HPP_
 #define _IMAGE2D_HPP_
+#include <algorithm>
+#include <cstddef>
 #include <vector>
+#include "Morton.h"
 
 namespace rt {
 
-/// Classe générique pour représenter des images 2D.
-template <typename TValue>
+/// Rangement des pixels ligne par ligne (rangement par défaut).
+struct RowMajorLayout {
+  /// @return le nombre de valeurs stockées pour une image w x h.
+  static std::size_t size( int w, int h ) { return (std::size_t) w * h; }
+  /// @return l'index du pixel (i,j) d'une image w x h.
+  static std::size_t index( int i, int j, int w, int /* h */ )
+  { return i + (std::size_t) j * w; }
+};
+
+/// Rangement par tuiles de S x S pixels (S puissance de 2) : chaque
+/// tuile occupe un bloc contigu, ses pixels étant rangés ligne par
+/// ligne, et les tuiles sont rangées ligne par ligne. Une tuile touche
+/// ainsi peu de lignes de cache et de pages, et deux tuiles voisines ne
+/// partagent pas de ligne de cache. L'image est complétée à un
+/// multiple de S.
+template <int S>
+struct TiledLayout {
+  static std::size_t size( int w, int h )
+  { return (std::size_t) tiles( w ) * tiles( h ) * S * S; }
+  static std::size_t index( int i, int j, int w, int /* h */ )
+  {
+    std::size_t tile = (std::size_t) ( j / S ) * tiles( w ) + i / S;
+    return tile * S * S + ( j % S ) * S + ( i % S );
+  }
+  static int tiles( int n ) { return ( n + S - 1 ) / S; }
+};
+
+/// Comme TiledLayout, mais les pixels d'une tuile sont rangés selon une
+/// courbe de Morton (ordre Z) : des pixels proches dans les deux
+/// directions sont aussi proches en mémoire.
+template <int S>
+struct MortonLayout {
+  static std::size_t size( int w, int h )
+  { return TiledLayout<S>::size( w, h ); }
+  static std::size_t index( int i, int j, int w, int /* h */ )
+  {
+    std::size_t tile = (std::size_t) ( j / S ) * TiledLayout<S>::tiles( w ) + i / S;
+    return tile * S * S + Morton::code2( i % S, j % S );
+  }
+};
+
+/// Classe générique pour représenter des images 2D. Le rangement des
+/// pixels en mémoire est donné par TLayout (RowMajorLayout,
+/// TiledLayout, MortonLayout). Les itérateurs parcourent les pixels
+/// dans l'ordre de ce rangement, qui n'est l'ordre des lignes que pour
+/// RowMajorLayout : pour parcourir les lignes, utiliser at().
+template <typename TValue, typename TLayout = RowMajorLayout>
 class Image2D {
 public:
-  typedef Image2D<TValue>    Self;      // le type de *this
+  typedef Image2D<TValue, TLayout> Self; // le type de *this
   typedef TValue             Value;     // le type pour la valeur des pixels
+  typedef TLayout            Layout;    // le rangement des pixels
   typedef std::vector<Value> Container; // le type pour stocker les valeurs des pixels de l'image.
   typedef typename Container::iterator ContainerIterator;
   typedef typename Container::const_iterator ContainerConstIterator;
@@ -62,8 +111,10 @@ public:
     typedef typename Accessor::Value     Value;      // unsigned char (pour ColorGreenAccessor)
     typedef typename Accessor::Reference Reference;  // ColorGreenReference (pour ColorGreenAccessor)
     
-    GenericConstIterator( const Image2D<ImageValue>& image, int x, int y )
+    GenericConstIterator( const Self& image, int x, int y )
       : Container::const_iterator( image.m_data.begin() + image.index( x, y ) ) {}
+    GenericConstIterator( const typename Container::const_iterator& other )
+      : Container::const_iterator( other ) {}
     
     // Accès en lecture (rvalue)
     Value operator*() const
@@ -78,8 +129,10 @@ public:
     typedef typename Accessor::Value     Value;      // unsigned char (pour ColorGreenAccessor)
     typedef typename Accessor::Reference Reference;  // ColorGreenReference (pour ColorGreenAccessor)
     
-    GenericIterator( Image2D<ImageValue>& image, int x, int y )
+    GenericIterator( Self& image, int x, int y )
       : Container::iterator( image.m_data.begin() + image.index( x, y ) ) {}
+    GenericIterator( const typename Container::iterator& other )
+      : Container::iterator( other ) {}
     
     // Accès en lecture (rvalue)
     Value operator*() const
@@ -96,6 +149,9 @@ public:
   // Constructeur avec taille w x h. Remplit tout avec la valeur g
   // (par défaut celle donnée par le constructeur par défaut).
   Image2D( int w, int h, Value g = Value() );
+  // Constructeur par copie d'une image rangée autrement.
+  template <typename TOtherLayout>
+  explicit Image2D( const Image2D<Value, TOtherLayout>& other );
   
   // Remplit l'image avec la valeur \a g.
   void fill( Value g );
@@ -106,9 +162,9 @@ public:
   int h() const;
 
   /// @return un itérateur pointant sur le début de l'image
-  Iterator begin() { return start( 0, 0 ); }
+  Iterator begin() { return Iterator( m_data.begin() ); }
   /// @return un itérateur pointant après la fin de l'image
-  Iterator end()   { return start( 0, h() ); }
+  Iterator end()   { return Iterator( m_data.end() ); }
   /// @return un itérateur pointant sur le pixel (x,y).
   Iterator start( int x, int y ) { return Iterator( *this, x, y ); }
 
@@ -122,7 +178,7 @@ public:
 
   template <typename Accessor>
   GenericConstIterator< Accessor > end() const
-  { return start< Accessor >( 0, h() ); }
+  { return GenericConstIterator< Accessor >( m_data.end() ); }
 
   template <typename Accessor>
   GenericIterator< Accessor > start( int x = 0, int y = 0 )
@@ -134,7 +190,7 @@ public:
 
   template <typename Accessor>
   GenericIterator< Accessor > end()
-  { return start< Accessor >( 0, h() ); }
+  { return GenericIterator< Accessor >( m_data.end() ); }
    
   /// Accesseur read-only à la valeur d'un pixel.
   /// @return la valeur du pixel(i,j)
@@ -150,55 +206,67 @@ private:
   int m_height; // ma hauteur
   
   /// @return l'index du pixel (x,y) dans le tableau \red m_data.
-  int index( int i, int j ) const;
+  std::size_t index( int i, int j ) const;
+
 };
 
-template <typename TValue>
-Image2D<TValue>::Image2D()
+template <typename TValue, typename TLayout>
+Image2D<TValue, TLayout>::Image2D()
   : m_data(), m_width( 0 ), m_height( 0 )
 {}
 
-template <typename TValue>
-Image2D<TValue>::Image2D( int w, int h, Value g )
-  : m_data( w*h, g ), m_width( w ), m_height( h )
+template <typename TValue, typename TLayout>
+Image2D<TValue, TLayout>::Image2D( int w, int h, Value g )
+  : m_data( TLayout::size( w, h ), g ), m_width( w ), m_height( h )
 {}
 
-template <typename TValue>
+template <typename TValue, typename TLayout>
+template <typename TOtherLayout>
+Image2D<TValue, TLayout>::Image2D( const Image2D<TValue, TOtherLayout>& other )
+  : m_data( TLayout::size( other.w(), other.h() ) ),
+    m_width( other.w() ), m_height( other.h() )
+{
+  for ( int j = 0; j < m_height; ++j )
+    for ( int i = 0; i < m_width; ++i )
+      at( i, j ) = other.at( i, j );
+}
+
+template <typename TValue, typename TLayout>
 void
-Image2D<TValue>::fill( Value g )
+Image2D<TValue, TLayout>::fill( Value g )
 {
-  m_data.fill( g );
+  std::fill( m_data.begin(), m_data.end(), g );
 }
 
-template <typename TValue>
+template <typename TValue, typename TLayout>
 int
-Image2D<TValue>::w() const
+Image2D<TValue, TLayout>::w() const
 { return m_width; }
 
-template <typename TValue>
+template <typename TValue, typename TLayout>
 int
-Image2D<TValue>::h() const
+Image2D<TValue, TLayout>::h() const
 { return m_height; }
 
-template <typename TValue>
-typename Image2D<TValue>::Value
-Image2D<TValue>::at( int i, int j ) const
+template <typename TValue, typename TLayout>
+typename Image2D<TValue, TLayout>::Value
+Image2D<TValue, TLayout>::at( int i, int j ) const
 {
   return m_data[ index( i, j ) ];
 }
 
-template <typename TValue>
-typename Image2D<TValue>::Value&
-Image2D<TValue>::at( int i, int j )
+template <typename TValue, typename TLayout>
+typename Image2D<TValue, TLayout>::Value&
+Image2D<TValue, TLayout>::at( int i, int j )
 {
   return m_data[ index( i, j ) ];
 }
 
-template <typename TValue>
-int
-Image2D<TValue>::index( int i, int j ) const
+template <typename TValue, typename TLayout>
+std::size_t
+Image2D<TValue, TLayout>::index( int i, int j ) const
 {
-  return i + j *w();
+  return TLayout::index( i, j, m_width, m_height );
 }
 
 } // namespace rt
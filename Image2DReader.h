@@ -0,0 +1,125 @@
+#ifndef _IMAGE2DREADER_HPP_
+#define _IMAGE2DREADER_HPP_
+
+#include <iostream>
+#include <string>
+#include "Color.h"
+#include "Image2D.h"
+
+namespace rt {
+
+template <typename TValue>
+class Image2DReader {
+public:
+  typedef TValue Value;
+  typedef Image2D<Value> Image;
+
+  static bool read( Image & img, std::istream & input );
+};
+
+template <typename TValue>
+bool
+Image2DReader<TValue>::read( Image & img, std::istream & input )
+{
+  return false;
+}
+
+/// Specialization for color images: reads PPM files, in ASCII (P3) or
+/// binary (P6) format, with any maximal value up to 255.
+template <>
+class Image2DReader<Color> {
+public:
+  typedef Color Value;
+  typedef Image2D<Value> Image;
+
+  static bool read( Image & img, std::istream & input );
+
+  /// Same as read, converting the colors to the pixels of \a img (e.g.
+  /// RGB8, see PixelFormat.h) as they are read.
+  template <typename TPixel>
+  static bool readAs( Image2D<TPixel> & img, std::istream & input );
+
+  /// Reads the header of a PPM image, up to its pixels.
+  /// @return 'false' if it is not a PPM image.
+  static bool readHeader( std::istream & input, bool & ascii,
+                          int & w, int & h, int & max_value );
+
+private:
+  /// Skips spaces and comments, then reads an integer of the header.
+  static bool readHeaderValue( std::istream & input, int & value );
+};
+
+
+inline bool
+Image2DReader<Color>::readHeaderValue( std::istream & input, int & value )
+{
+  input >> std::ws;
+  while ( input.peek() == '#' )
+    {
+      std::string comment;
+      std::getline( input, comment );
+      input >> std::ws;
+    }
+  return (bool) ( input >> value );
+}
+
+inline bool
+Image2DReader<Color>::readHeader( std::istream & input, bool & ascii,
+                                  int & w, int & h, int & max_value )
+{
+  std::string format;
+  input >> format;
+  ascii = format == "P3";
+  if ( ( ! ascii && format != "P6" )
+       || ! readHeaderValue( input, w ) || ! readHeaderValue( input, h )
+       || ! readHeaderValue( input, max_value )
+       || w <= 0 || h <= 0 || max_value <= 0 || max_value > 255 )
+    return false;
+  // Exactly one space separates the header from binary data.
+  if ( ! ascii ) input.get();
+  return true;
+}
+
+inline bool
+Image2DReader<Color>::read( Image & img, std::istream & input )
+{
+  return readAs( img, input );
+}
+
+template <typename TPixel>
+bool
+Image2DReader<Color>::readAs( Image2D<TPixel> & img, std::istream & input )
+{
+  bool ascii;
+  int w, h, max_value;
+  if ( ! readHeader( input, ascii, w, h, max_value ) )
+    {
+      std::cerr << "Image2DReader: not a PPM (P3 or P6) image." << std::endl;
+      return false;
+    }
+  img = Image2D<TPixel>( w, h );
+  Real scale = 1.0f / (Real) max_value;
+  for ( typename Image2D<TPixel>::Iterator it = img.begin(), itE = img.end(); it != itE; ++it )
+    {
+      int red, green, blue;
+      if ( ascii )
+        input >> red >> green >> blue;
+      else
+        {
+          red   = input.get();
+          green = input.get();
+          blue  = input.get();
+        }
+      if ( input.fail() )
+        {
+          std::cerr << "Image2DReader: truncated image." << std::endl;
+          return false;
+        }
+      *it = TPixel( Color( red * scale, green * scale, blue * scale ) );
+    }
+  return true;
+}
+
+} // namespace rt
+
+#endif // _IMAGE2DREADER_HPP_
@@ -3,8 +3,10 @@
 
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include "Color.h"
 #include "Image2D.h"
+#include "PixelFormat.h"
 
 namespace rt {
 
@@ -24,30 +26,75 @@ Image2DWriter<TValue>::write( Image & img, std::ostream & output, bool ascii )
   return false;
 }
 
-/// Specialization for gray-level images.
+/// Specialization for gray-level images. Images of any layout (see
+/// Image2D) are written, in scanline order.
 template <>
 class Image2DWriter<unsigned char> {
 public:
   typedef unsigned char Value;
   typedef Image2D<Value> Image;
 
-  static bool write( Image & img, std::ostream & output, bool ascii );
+  template <typename TLayout>
+  static bool write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii );
 };
 
-/// Specialization for color images.
+/// Specialization for color images. Images of any layout (see
+/// Image2D) are written, in scanline order.
 template <>
 class Image2DWriter<Color> {
 public:
   typedef Color Value;
   typedef Image2D<Value> Image;
 
-  static bool write( Image & img, std::ostream & output, bool ascii );
+  template <typename TLayout>
+  static bool write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii );
+};
+
+/// Writer of the compact pixel types (see PixelFormat.h), which give
+/// their 8 bits channels with toRGB8. Images of any layout are written,
+/// in scanline order.
+template <typename TValue>
+class PixelImage2DWriter {
+public:
+  typedef TValue Value;
+  typedef Image2D<Value> Image;
+
+  template <typename TLayout>
+  static bool write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii );
 };
 
+/// Specialization for RGB8 images. Pixels are already the bytes of the
+/// file, so that a row by row image is written in one block.
+template <>
+class Image2DWriter<RGB8> : public PixelImage2DWriter<RGB8> {
+public:
+  template <typename TLayout>
+  static bool write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii )
+  {
+    if ( ascii || ! std::is_same<TLayout, RowMajorLayout>::value || sizeof( RGB8 ) != 3 )
+      return PixelImage2DWriter<RGB8>::write( img, output, ascii );
+    output << "P6" << std::endl;
+    output << "# Generated by You !" << std::endl;
+    output << img.w() << " " << img.h() << std::endl;
+    output << "255" << std::endl;
+    if ( img.w() > 0 && img.h() > 0 )
+      output.write( (const char*) img.at( 0, 0 ).rgb, (std::streamsize) img.w() * img.h() * 3 );
+    return output.good();
+  }
+};
 
+/// Specialization for RGB565 images.
+template <>
+class Image2DWriter<RGB565> : public PixelImage2DWriter<RGB565> {};
 
-bool
-Image2DWriter<unsigned char>::write( Image & img, std::ostream & output, bool ascii )
+/// Specialization for RGBHalf images.
+template <>
+class Image2DWriter<RGBHalf> : public PixelImage2DWriter<RGBHalf> {};
+
+
+template <typename TLayout>
+inline bool
+Image2DWriter<unsigned char>::write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii )
 {
   typedef unsigned char GrayLevel;
   output << ( ascii ? "P2" : "P5" ) << std::endl;
@@ -56,20 +103,23 @@ Image2DWriter<unsigned char>::write( Image & img, std::ostream & output, bool as
   output << "255" << std::endl;
   if ( ascii ) 
     {
-      for ( Image::Iterator it = img.begin(), itE = img.end(); it != itE; ++it )
-	output << (int) *it << " ";
+      for ( int y = 0; y < img.h(); ++y )
+        for ( int x = 0; x < img.w(); ++x )
+	  output << (int) img.at( x, y ) << " ";
     }
   else 
     {
-      for ( Image::Iterator it = img.begin(), itE = img.end(); it != itE; ++it )
-	output << (GrayLevel) *it;
+      for ( int y = 0; y < img.h(); ++y )
+        for ( int x = 0; x < img.w(); ++x )
+	  output << (GrayLevel) img.at( x, y );
     }
   return true;
 }
 
 
-bool
-Image2DWriter<Color>::write( Image & img, std::ostream & output, bool ascii )
+template <typename TLayout>
+inline bool
+Image2DWriter<Color>::write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii )
 {
   output << ( ascii ? "P3" : "P6" ) << std::endl;
   output << "# Generated by You !" << std::endl;
@@ -77,17 +127,19 @@ Image2DWriter<Color>::write( Image & img, std::ostream & output, bool ascii )
   output << "255" << std::endl;
   if ( ascii ) 
     {
-      for ( Image::Iterator it = img.begin(), itE = img.end(); it != itE; ++it )
+      for ( int y = 0; y < img.h(); ++y )
+        for ( int x = 0; x < img.w(); ++x )
 	{ 
-	  Color c = *it;
+	  Color c = img.at( x, y );
 	  output << (int) (c.r()*255.0f) << " " << (int) (c.g()*255.0f) << " " << (int) (c.b()*255.0f) << " ";
 	}
     }
   else 
     {
-      for ( Image::Iterator it = img.begin(), itE = img.end(); it != itE; ++it )
+      for ( int y = 0; y < img.h(); ++y )
+        for ( int x = 0; x < img.w(); ++x )
 	{ 
-	  Color c = *it;
+	  Color c = img.at( x, y );
           unsigned char red = (unsigned char) (c.r()*255.0f);
           unsigned char green = (unsigned char) (c.g()*255.0f);
           unsigned char blue = (unsigned char) (c.b()*255.0f);
@@ -97,6 +149,28 @@ Image2DWriter<Color>::write( Image & img, std::ostream & output, bool ascii )
   return true;
 }
 
+template <typename TValue>
+template <typename TLayout>
+inline bool
+PixelImage2DWriter<TValue>::write( Image2D<Value, TLayout> & img, std::ostream & output, bool ascii )
+{
+  output << ( ascii ? "P3" : "P6" ) << std::endl;
+  output << "# Generated by You !" << std::endl;
+  output << img.w() << " " << img.h() << std::endl;
+  output << "255" << std::endl;
+  std::vector<unsigned char> row( (std::size_t) img.w() * 3 );
+  for ( int y = 0; y < img.h(); ++y )
+    {
+      for ( int x = 0; x < img.w(); ++x )
+        img.at( x, y ).toRGB8( &row[ (std::size_t) x * 3 ] );
+      if ( ascii )
+        for ( unsigned char v : row ) output << (int) v << " ";
+      else if ( ! row.empty() )
+        output.write( (const char*) row.data(), (std::streamsize) row.size() );
+    }
+  return output.good();
+}
+
 } // namespace rt
 
 #endif // _IMAGE2DWRITER_HPP_
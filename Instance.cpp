@@ -0,0 +1,66 @@
+/**
+@file Instance.cpp
+*/
+#include "Instance.h"
+
+void
+rt::Instance::setTransform(const Transform &aTransform) {
+    myTransform = aTransform;
+    myInverse = aTransform.inverse();
+    myBox = myTransform.box(prototype->getBoundingBox());
+}
+
+void
+rt::Instance::init(Viewer &viewer) {
+    prototype->init(viewer);
+}
+
+void
+rt::Instance::draw(Viewer &viewer) {
+    float gl[16];
+    myTransform.getGLMatrix(gl);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glMultMatrixf(gl);
+    // Scalings must not change the lighting.
+    glEnable(GL_NORMALIZE);
+    prototype->draw(viewer);
+    glPopMatrix();
+}
+
+rt::Vector3
+rt::Instance::getNormal(Point3 p) {
+    return fromPrototypeNormal(prototype->getNormal(myInverse.point(p)));
+}
+
+rt::Material
+rt::Instance::getMaterial(Point3 p) {
+    return prototype->getMaterial(myInverse.point(p));
+}
+
+rt::Real
+rt::Instance::rayIntersection(const Ray &ray, Point3 &p) {
+    Point3 q;
+    Real d = prototype->rayIntersection(toPrototype(ray), q);
+    if (d > 0.0f) return d;
+    p = myTransform.point(q);
+    return -rt::distance(ray.origin, p);
+}
+
+rt::Real
+rt::Instance::rayIntersection(const Ray &ray, RayHit &hit) {
+    Real d = prototype->rayIntersection(toPrototype(ray), hit);
+    if (d > 0.0f) return d;
+    hit.point = myTransform.point(hit.point);
+    hit.normal = fromPrototypeNormal(hit.normal);
+    return -rt::distance(ray.origin, hit.point);
+}
+
+rt::Real
+rt::Instance::primitiveIntersection(const Ray &ray, unsigned int primitive, RayHit &hit) {
+    Real d = prototype->primitiveIntersection(toPrototype(ray), primitive, hit);
+    if (d > 0.0f) return d;
+    hit.point = myTransform.point(hit.point);
+    hit.normal = fromPrototypeNormal(hit.normal);
+    return -rt::distance(ray.origin, hit.point);
+}
@@ -0,0 +1,111 @@
+/**
+@file Instance.h
+*/
+#pragma once
+#ifndef _INSTANCE_H_
+#define _INSTANCE_H_
+
+#include <memory>
+#include "GraphicalObject.h"
+#include "Transform.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A copy of a prototype object (a set of spheres, a mesh, etc) placed
+  /// in the scene by a transformation. The prototype is shared by all
+  /// its instances and never copied: rays are brought back into the
+  /// space of the prototype, which is intersected with its own
+  /// acceleration structure. Memory thus grows with the number of
+  /// different prototypes, not with the number of instances.
+  ///
+  /// @note The prototype is deleted with its last instance. It must not
+  /// be added to the scene itself, and must not be changed while it is
+  /// instanced (its bounding box is used when the instance is placed).
+  struct Instance : public GraphicalObject {
+
+    /// Virtual destructor since object contains virtual methods.
+    virtual ~Instance() {}
+
+    /// Creates an instance of \a aPrototype placed by \a aTransform.
+    Instance( const std::shared_ptr<GraphicalObject>& aPrototype,
+              const Transform& aTransform = Transform() )
+      : GraphicalObject(), prototype( aPrototype )
+    {
+      setTransform( aTransform );
+    }
+
+    /// Moves the instance. Scene::objectMoved must then be called.
+    void setTransform( const Transform& aTransform );
+
+    /// @return the transformation from the prototype to the scene.
+    const Transform& transform() const { return myTransform; }
+
+    // ---------------- GraphicalObject services ----------------------------
+  public:
+    using GraphicalObject::rayIntersection;
+
+    /// This method is called by Scene::init() at the beginning of the
+    /// display in the OpenGL window.
+    void init( Viewer& viewer );
+
+    /// This method is called by Scene::draw() at each frame to
+    /// redisplay objects in the OpenGL window.
+    void draw( Viewer& viewer );
+
+    /// @return the normal vector at point \a p on the instance.
+    Vector3 getNormal( Point3 p );
+
+    /// @return the material of the prototype at point \a p.
+    Material getMaterial( Point3 p );
+
+    /// @param[in] ray the incoming ray
+    /// @param[out] returns the point of intersection with the instance
+    /// (if any).
+    ///
+    /// @return either a real < 0.0 if there is an intersection, or a
+    /// positive real otherwise.
+    Real rayIntersection( const Ray& ray, Point3& p );
+
+    /// Same as above, and also gives the normal and material at the
+    /// point of intersection (hit.primitive is the primitive of the
+    /// prototype).
+    Real rayIntersection( const Ray& ray, RayHit& hit );
+
+    /// Same as above, for the primitive \a primitive of the prototype
+    /// only.
+    Real primitiveIntersection( const Ray& ray, unsigned int primitive, RayHit& hit );
+
+    /// @return 'true' if the prototype is opaque.
+    bool isOpaque() { return prototype->isOpaque(); }
+
+    /// @return the box of the prototype moved by the transformation.
+    BoundingBox getBoundingBox() { return myBox; }
+
+  public:
+    /// The shared prototype.
+    std::shared_ptr<GraphicalObject> prototype;
+
+  protected:
+    Transform myTransform;
+    /// inverse of myTransform, brings rays to the prototype.
+    Transform myInverse;
+    BoundingBox myBox;
+
+    /// @return the ray in the space of the prototype.
+    Ray toPrototype( const Ray& ray ) const
+    {
+      return Ray( myInverse.point( ray.origin ), myInverse.vector( ray.direction ), ray.depth );
+    }
+    /// @return the normal \a n of the prototype in the scene (normalized).
+    Vector3 fromPrototypeNormal( const Vector3& n ) const
+    {
+      Vector3 w = myInverse.transposedVector( n );
+      Real l = w.norm();
+      return l != 0.0f ? w / l : w;
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _INSTANCE_H_
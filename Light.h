@@ -6,13 +6,28 @@
 #ifndef _LIGHT_H_
 #define _LIGHT_H_
 
+#include <algorithm>
+#include <limits>
+#include <math.h>
 // In order to call opengl commands in all graphical objects
 #include "Viewer.h"
 #include "PointVector.h"
+#include "Color.h"
 
 /// Namespace RayTracer
 namespace rt {
 
+  /// What a light gives to a point p, as computed by Light::sample.
+  struct LightSample {
+    /// the normalized direction from p to the light.
+    Vector3 direction;
+    /// the distance from p to the light (infinity for a light at
+    /// infinity). Objects farther than it cannot cast shadows.
+    Real distance;
+    /// the color of the light received at p.
+    Color color;
+  };
+
   /// Lights are used to give lights in a scene.
   struct Light {
 
@@ -42,6 +57,47 @@ namespace rt {
     /// p.
     virtual Color color( const Vector3& /* p */ ) const = 0;
 
+    /// @return the direction, distance and color of this light viewed
+    /// from the given point \a p, computed at once. The default
+    /// implementation calls direction() and color(), and gives an
+    /// infinite distance.
+    virtual LightSample sample( const Vector3& p ) const
+    {
+      LightSample s;
+      s.direction = direction( p );
+      s.distance  = std::numeric_limits<Real>::infinity();
+      s.color     = color( p );
+      return s;
+    }
+
+    /// @return 'true' if the light has an area, and thus casts soft
+    /// shadows (see sample( p, u, v )).
+    virtual bool hasArea() const { return false; }
+
+    /// @return the sample of the point of the light given by (\a u, \a
+    /// v) in [0,1]^2 viewed from \a p. Uniformly distributed (u,v) give
+    /// points uniformly distributed on the visible surface of the light.
+    /// Lights without area give sample( p ).
+    virtual LightSample sample( const Vector3& p, Real /* u */, Real /* v */ ) const
+    {
+      return sample( p );
+    }
+
+    /// @return 'true' if the light is at infinity, i.e. its direction
+    /// does not depend on the point.
+    virtual bool isAtInfinity() const { return false; }
+
+    /// @return the intensity of the disc displayed around the light in
+    /// the background, in a direction whose cosine with the direction
+    /// of the light is \a cos_a (0 outside the disc).
+    static Real discIntensity( Real cos_a )
+    {
+      if ( cos_a <= 0.99f ) return 0.0f;
+      Real a = acos( cos_a ) * 360.0 / M_PI / 8.0;
+      a = std::max( 1.0f - a, 0.0f );
+      return a * a;
+    }
+
   };
 
 } // namespace rt
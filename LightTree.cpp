@@ -0,0 +1,91 @@
+/**
+@file LightTree.cpp
+*/
+#include <algorithm>
+#include <cmath>
+#include "LightTree.h"
+
+void
+rt::LightTree::build(const std::vector<Light *> &lights) {
+    myLights.clear();
+    myUnclustered.clear();
+    std::vector<unsigned int> items;
+    std::vector<BoundingBox> boxes;
+    std::vector<int> leaves;
+    for (Light *light : lights) {
+        // The position of the light is given by its direction and
+        // distance from any point.
+        LightSample s = light->sample(Point3(0, 0, 0));
+        if (light->isAtInfinity() || !std::isfinite(s.distance)) {
+            myUnclustered.push_back(light);
+            continue;
+        }
+        Point3 position = s.distance * s.direction;
+        items.push_back((unsigned int) myLights.size());
+        boxes.push_back(BoundingBox(position, position));
+        myLights.push_back(light);
+    }
+    myIndex.build(items, boxes, leaves);
+    myIntensities.assign(myIndex.nbNodes(), 0.0f);
+    if (myIndex.root() != BVH<unsigned int>::NONE) computeIntensity(myIndex.root());
+}
+
+rt::Real
+rt::LightTree::computeIntensity(int n) {
+    const BVH<unsigned int>::Node &node = myIndex.node(n);
+    if (node.isLeaf()) {
+        Color c = myLights[node.item]->sample(node.box.lo).color;
+        myIntensities[n] = (c.r() + c.g() + c.b()) / 3.0f;
+    } else
+        myIntensities[n] = computeIntensity(node.left) + computeIntensity(node.right);
+    return myIntensities[n];
+}
+
+rt::Real
+rt::LightTree::importance(int node, const Point3 &p, const Vector3 &n) const {
+    const BoundingBox &box = myIndex.node(node).box;
+    Vector3 v = 0.5f * (box.lo + box.hi) - p;
+    Real r = 0.5f * rt::distance(box.lo, box.hi);
+    Real d = v.norm();
+    Real bound = 1.0f;
+    if (d > r) {
+        // The box is seen from p in a cone of axis v and half-angle t.
+        // The cosine with n is at most cos(max(a - t, 0)), where a is
+        // the angle between n and v.
+        Real cos_a = n.dot(v) / d;
+        Real sin_t = r / d;
+        Real cos_t = sqrt(1.0f - sin_t * sin_t);
+        if (cos_a < cos_t) {
+            Real sin_a = sqrt(std::max(0.0f, 1.0f - cos_a * cos_a));
+            bound = cos_a * cos_t + sin_a * sin_t;
+        }
+    }
+    return myIntensities[node] * std::max(bound, MIN_COSINE);
+}
+
+rt::Light *
+rt::LightTree::sample(const Point3 &p, const Vector3 &n, Real u, Real &pdf) const {
+    typedef BVH<unsigned int> Index;
+    pdf = 1.0f;
+    int node = myIndex.root();
+    if (node == Index::NONE) return 0;
+    while (!myIndex.node(node).isLeaf()) {
+        const Index::Node &nd = myIndex.node(node);
+        Real w_left = importance(nd.left, p, n);
+        Real w_right = importance(nd.right, p, n);
+        if (w_left + w_right <= 0.0f) return 0;
+        Real p_left = w_left / (w_left + w_right);
+        // u is rescaled so that it can be used again below.
+        if (u < p_left) {
+            node = nd.left;
+            pdf *= p_left;
+            u = u / p_left;
+        } else {
+            node = nd.right;
+            pdf *= 1.0f - p_left;
+            u = (u - p_left) / (1.0f - p_left);
+        }
+        u = std::min(u, 0.99999994f);
+    }
+    return myLights[myIndex.node(node).item];
+}
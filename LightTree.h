@@ -0,0 +1,76 @@
+/**
+@file LightTree.h
+*/
+#pragma once
+#ifndef _LIGHT_TREE_H_
+#define _LIGHT_TREE_H_
+
+#include <vector>
+#include "Light.h"
+#include "BVH.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A hierarchy over the lights at finite distance of a scene, each
+  /// node storing the box of its lights and their total intensity. It
+  /// is used to pick, at each shaded point, a few lights with a
+  /// probability close to their contribution, instead of evaluating
+  /// (and tracing shadow rays to) all of them.
+  ///
+  /// The contribution of a light does not decrease with its distance
+  /// in this ray-tracer (see PointLight), so the importance of a node
+  /// is its intensity times a bound of the cosine between the normal
+  /// and the directions to its box. The cosine bound never goes below
+  /// MIN_COSINE: the specular term does not vanish behind the surface,
+  /// and no light must have a zero probability for the estimate to
+  /// stay unbiased.
+  ///
+  /// The estimate of the lighting with n samples has a variance in
+  /// 1/n, i.e. a noise in 1/sqrt(n). When the tree holds at most n
+  /// lights, they should rather all be evaluated (no noise).
+  struct LightTree {
+
+    /// Lowest cosine bound used in the importance of a node.
+    static constexpr Real MIN_COSINE = 0.05f;
+
+    /// Rebuilds the tree over the lights of \a lights that are not at
+    /// infinity (the other ones are given by unclustered()). Lights
+    /// must not move until the next build.
+    void build( const std::vector<Light*>& lights );
+
+    /// @return the number of lights in the tree.
+    int size() const { return myIndex.size(); }
+
+    /// @return the lights that are not in the tree (lights at
+    /// infinity), which must always be evaluated.
+    const std::vector<Light*>& unclustered() const { return myUnclustered; }
+
+    /// Picks a light of the tree for the point \a p of normal \a n,
+    /// descending from the root and choosing each child with a
+    /// probability proportional to its importance.
+    ///
+    /// @param u a random number in [0,1[.
+    /// @param[out] pdf the probability of the light that was picked.
+    /// @return the light (0 if the tree is empty).
+    Light* sample( const Point3& p, const Vector3& n, Real u, Real& pdf ) const;
+
+  private:
+    /// The lights at finite distance.
+    std::vector<Light*> myLights;
+    /// The lights at infinity.
+    std::vector<Light*> myUnclustered;
+    /// The hierarchy over myLights (items are indices).
+    BVH<unsigned int> myIndex;
+    /// Intensity of the lights of each node of myIndex.
+    std::vector<Real> myIntensities;
+
+    /// Computes myIntensities for the subtree \a n.
+    Real computeIntensity( int n );
+    /// @return the importance of node \a n for the point \a p of normal \a n.
+    Real importance( int node, const Point3& p, const Vector3& n ) const;
+  };
+
+} // namespace rt
+
+#endif // #define _LIGHT_TREE_H_
@@ -0,0 +1,131 @@
+/**
+@file MappedImage.cpp
+*/
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "MappedImage.h"
+#include "Image2DReader.h"
+
+bool
+rt::MappedImage::open(const std::string &filename, int width, int height, bool keep) {
+    close();
+    // Same header as Image2DWriter<Color>.
+    std::ostringstream header;
+    header << "P6" << std::endl
+           << "# Generated by You !" << std::endl
+           << width << " " << height << std::endl
+           << "255" << std::endl;
+    std::string h = header.str();
+    std::size_t kept = keep ? pixelsOffset(filename, width, height) : 0;
+    myHeaderSize = kept != 0 ? kept : h.size();
+    mySize = myHeaderSize + (std::size_t) width * (std::size_t) height * 3;
+    myFile = ::open(filename.c_str(), O_RDWR | O_CREAT | (kept != 0 ? 0 : O_TRUNC), 0644);
+    if (myFile < 0) {
+        std::cerr << "[MappedImage::open] Unable to create " << filename << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (::ftruncate(myFile, (off_t) mySize) != 0) {
+        std::cerr << "[MappedImage::open] Unable to resize " << filename << " to "
+                  << mySize << " bytes: " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    void *data = ::mmap(0, mySize, PROT_READ | PROT_WRITE, MAP_SHARED, myFile, 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "[MappedImage::open] Unable to map " << filename << ": "
+                  << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    myData = (unsigned char *) data;
+    myWidth = width;
+    myHeight = height;
+    myRowWidth = width;
+    myRowPixels.assign(height, 0);
+    if (kept == 0) std::memcpy(myData, h.data(), myHeaderSize);
+    return true;
+}
+
+std::size_t
+rt::MappedImage::pixelsOffset(const std::string &filename, int width, int height) {
+    std::ifstream input(filename, std::ios::binary);
+    bool ascii;
+    int w, h, max_value;
+    if (!input.good() || !Image2DReader<Color>::readHeader(input, ascii, w, h, max_value)
+        || ascii || w != width || h != height || max_value != 255)
+        return 0;
+    std::streamoff offset = input.tellg();
+    input.seekg(0, std::ios::end);
+    std::streamoff size = input.tellg();
+    if (offset <= 0 || size != offset + (std::streamoff) width * height * 3) return 0;
+    return (std::size_t) offset;
+}
+
+void
+rt::MappedImage::setColumns(int x0, int x1) {
+    x0 = std::max(x0, 0);
+    x1 = std::max(x0, std::min(x1, myWidth));
+    myRowWidth = x1 - x0;
+}
+
+void
+rt::MappedImage::close() {
+    if (myData != 0) {
+        ::msync(myData, mySize, MS_SYNC);
+        ::munmap(myData, mySize);
+        myData = 0;
+    }
+    if (myFile >= 0) {
+        ::close(myFile);
+        myFile = -1;
+    }
+    mySize = 0;
+    myRowPixels.clear();
+}
+
+void
+rt::MappedImage::writeTile(int x0, int y0, int x1, int y1, const Color *pixels,
+                           const unsigned char *rendered) {
+    for (int y = y0; y < y1; ++y) {
+        unsigned char *p = myData + myHeaderSize + ((std::size_t) y * myWidth + x0) * 3;
+        for (int x = x0; x < x1; ++x, ++pixels, p += 3) {
+            if (rendered != 0 && *rendered++ == 0) continue;
+            // Same conversion as Image2DWriter<Color>.
+            p[0] = (unsigned char) (pixels->r() * 255.0f);
+            p[1] = (unsigned char) (pixels->g() * 255.0f);
+            p[2] = (unsigned char) (pixels->b() * 255.0f);
+        }
+    }
+    // Tiles may come in any order: the rows are released once all the
+    // tiles covering them are written.
+    int first = -1;
+    for (int y = y0; y <= y1; ++y) {
+        bool complete = y < y1 && (myRowPixels[y] += x1 - x0) >= myRowWidth;
+        if (complete && first < 0) first = y;
+        else if (!complete && first >= 0) {
+            release(first, y);
+            first = -1;
+        }
+    }
+}
+
+void
+rt::MappedImage::release(int y0, int y1) {
+    // The range is extended to whole pages. Pages shared with the next
+    // rows are written too, which is harmless: they are read back from
+    // the file when these rows are written.
+    std::size_t page = (std::size_t) ::sysconf(_SC_PAGESIZE);
+    std::size_t begin = myHeaderSize + (std::size_t) y0 * myWidth * 3;
+    std::size_t end = myHeaderSize + (std::size_t) y1 * myWidth * 3;
+    begin -= begin % page;
+    ::msync(myData + begin, end - begin, MS_ASYNC);
+    ::madvise(myData + begin, end - begin, MADV_DONTNEED);
+}
@@ -0,0 +1,78 @@
+/**
+@file MappedImage.h
+*/
+#pragma once
+#ifndef _MAPPED_IMAGE_H_
+#define _MAPPED_IMAGE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "TileSink.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A binary PPM file (P6) mapped in memory, into which tiles are
+  /// written directly. The image never exists as a whole in memory: a
+  /// 40000x40000 image, which would take 19 GB as an Image2D<Color>,
+  /// only needs the pages of the rows being rendered. Each time the tiles
+  /// written cover a row of the region (see setColumns), its pages are
+  /// given back to the system, which writes them to the file.
+  ///
+  /// The file is the same as the one of Image2DWriter<Color>. It uses
+  /// the POSIX functions mmap and msync.
+  struct MappedImage : public TileSink {
+
+    MappedImage() {}
+    /// Unmaps (and thus writes) the file.
+    ~MappedImage() { close(); }
+
+    /// Creates the file \a filename for an image of size \a width x \a
+    /// height, and maps it in memory. When \a keep and the file is
+    /// already a binary PPM of this size, its pixels are kept (e.g. the
+    /// ones outside the region, see Renderer::setRegion), otherwise the
+    /// image starts black.
+    /// @return 'true' if it succeeded.
+    bool open( const std::string& filename, int width, int height, bool keep = false );
+
+    /// Tells that tiles only cover the columns [x0,x1[ of the image (see
+    /// Renderer::setRegion), all of them otherwise. Rows are thus
+    /// released once x1 - x0 of their pixels are written. Must be called
+    /// after open().
+    void setColumns( int x0, int x1 );
+
+    /// Writes the remaining pages and unmaps the file.
+    void close();
+
+    void writeTile( int x0, int y0, int x1, int y1, const Color* pixels,
+                    const unsigned char* rendered );
+
+  private:
+    MappedImage( const MappedImage& ) = delete;
+    MappedImage& operator=( const MappedImage& ) = delete;
+
+    int myWidth = 0;
+    int myHeight = 0;
+    int myFile = -1;
+    /// The mapped file, and its size.
+    unsigned char* myData = 0;
+    std::size_t mySize = 0;
+    /// The size of the header, before the pixels.
+    std::size_t myHeaderSize = 0;
+    /// The number of pixels of a row covered by the tiles.
+    int myRowWidth = 0;
+    /// The number of pixels written in each row.
+    std::vector<int> myRowPixels;
+
+    /// @return the offset of the pixels in \a filename if it is a binary
+    /// PPM of size \a width x \a height with 8 bits channels, 0 otherwise.
+    static std::size_t pixelsOffset( const std::string& filename, int width, int height );
+
+    /// Writes the pages of the rows [y0,y1[ and releases them.
+    void release( int y0, int y1 );
+  };
+
+} // namespace rt
+
+#endif // #define _MAPPED_IMAGE_H_
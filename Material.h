@@ -40,6 +40,12 @@ namespace rt {
     /// Outside refractive index (1.0f if object is in the air otherwise >= 1.0f)
     Real out_refractive_index;
 
+    /// @return 'true' if no light goes through the material.
+    bool isOpaque() const
+    {
+      return coef_refraction == 0.0f || diffuse.max() == 0.0f;
+    }
+
     /// Mixes two material (t=0 gives m1, t=1 gives m2, t=0.5 gives their average)
     static Material mix( Real t, const Material& m1, const Material& m2 )
     {
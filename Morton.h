@@ -0,0 +1,56 @@
+/**
+@file Morton.h
+*/
+#pragma once
+#ifndef _MORTON_H_
+#define _MORTON_H_
+
+#include <cstdint>
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Morton codes (Z-order curve): the bits of the coordinates are
+  /// interleaved, so that points close in space get close codes, and
+  /// sorting by code groups neighbours together.
+  namespace Morton {
+
+    /// @return the 16 lowest bits of \a x, spaced by one zero.
+    inline std::uint32_t spread2( std::uint32_t x )
+    {
+      x &= 0xffffu;
+      x = ( x | ( x << 8 ) ) & 0x00ff00ffu;
+      x = ( x | ( x << 4 ) ) & 0x0f0f0f0fu;
+      x = ( x | ( x << 2 ) ) & 0x33333333u;
+      x = ( x | ( x << 1 ) ) & 0x55555555u;
+      return x;
+    }
+
+    /// @return the 32 bits code of the cell (x,y), with coordinates in [0,65536[.
+    inline std::uint32_t code2( std::uint32_t x, std::uint32_t y )
+    {
+      return spread2( x ) | ( spread2( y ) << 1 );
+    }
+
+    /// @return the 10 lowest bits of \a x, spaced by two zeros.
+    inline std::uint32_t spread3( std::uint32_t x )
+    {
+      x &= 0x3ffu;
+      x = ( x | ( x << 16 ) ) & 0x030000ffu;
+      x = ( x | ( x <<  8 ) ) & 0x0300f00fu;
+      x = ( x | ( x <<  4 ) ) & 0x030c30c3u;
+      x = ( x | ( x <<  2 ) ) & 0x09249249u;
+      return x;
+    }
+
+    /// @return the 30 bits code of the cell (x,y,z), with coordinates in [0,1024[.
+    inline std::uint32_t code3( std::uint32_t x, std::uint32_t y, std::uint32_t z )
+    {
+      return spread3( x ) | ( spread3( y ) << 1 ) | ( spread3( z ) << 2 );
+    }
+
+  } // namespace Morton
+
+} // namespace rt
+
+#endif // #define _MORTON_H_
@@ -0,0 +1,125 @@
+/**
+@file ObjReader.cpp
+*/
+#include <chrono>
+#include <fstream>
+#include "ObjReader.h"
+#include "TextParser.h"
+
+using namespace rt::TextParser;
+
+rt::ObjReader::ObjReader()
+        : nbBytes(0), nbTriangles(0), parseTime(0.0), indexTime(0.0),
+          myMesh(0), myFirstVertex(0), myFirstNormal(0), myLine(0) {}
+
+bool
+rt::ObjReader::read(TriangleMesh &mesh, const std::string &filename) {
+    std::ifstream input(filename.c_str(), std::ios::binary);
+    if (!input.good()) {
+        std::cerr << "ObjReader: unable to open " << filename << std::endl;
+        return false;
+    }
+    return read(mesh, input);
+}
+
+bool
+rt::ObjReader::read(TriangleMesh &mesh, std::istream &input) {
+    auto t0 = std::chrono::steady_clock::now();
+    myMesh = &mesh;
+    myFirstVertex = mesh.vertices.size();
+    myFirstNormal = mesh.normals.size();
+    myLine = 0;
+    std::size_t first_face = mesh.faces.size();
+    auto parse_line = [this](const char *line) { return parseLine(line); };
+    bool ok = readLines(input, nbBytes, parse_line);
+    nbTriangles = mesh.faces.size() - first_face;
+    auto t1 = std::chrono::steady_clock::now();
+    if (ok) mesh.buildIndex();
+    auto t2 = std::chrono::steady_clock::now();
+    parseTime = std::chrono::duration<double>(t1 - t0).count();
+    indexTime = std::chrono::duration<double>(t2 - t1).count();
+    myMesh = 0;
+    return ok;
+}
+
+void
+rt::ObjReader::displayStatistics(std::ostream &output) const {
+    double mb = nbBytes / 1e6;
+    output << "Read " << nbTriangles << " triangles (" << mb << " MB) in "
+           << parseTime << " s: " << (parseTime > 0.0 ? nbTriangles / parseTime : 0.0)
+           << " triangles/s, " << (parseTime > 0.0 ? mb / parseTime : 0.0) << " MB/s."
+           << " Index built in " << indexTime << " s." << std::endl;
+}
+
+bool
+rt::ObjReader::parseLine(const char *s) {
+    ++myLine;
+    const char *word;
+    std::size_t length = token(s, word);
+    if (length == 0 || *word == '#') return true;
+    if (matches(word, length, "v")) {
+        // An optional w coordinate may follow.
+        Real v[3];
+        if (!parseReals(s, v, 3)) return error("v: x y z expected");
+        myMesh->addVertex(Point3(v[0], v[1], v[2]));
+    } else if (matches(word, length, "vn")) {
+        Real v[3];
+        if (!parseReals(s, v, 3)) return error("vn: x y z expected");
+        myMesh->addNormal(Vector3(v[0], v[1], v[2]));
+    } else if (matches(word, length, "f")) {
+        // The polygon (v0, v1, ..., vn) gives the triangles (v0, vi-1, vi).
+        unsigned int v[3], n[3];
+        int count = 0;
+        while (!isEnd(s)) {
+            int k = count < 2 ? count : 2;
+            if (!parseFaceVertex(s, v[k], n[k])) return false;
+            if (++count >= 3) {
+                bool smooth = n[0] != TriangleMesh::NO_NORMAL && n[1] != TriangleMesh::NO_NORMAL
+                              && n[2] != TriangleMesh::NO_NORMAL;
+                if (smooth) myMesh->addTriangle(v[0], v[1], v[2], n[0], n[1], n[2]);
+                else myMesh->addTriangle(v[0], v[1], v[2]);
+                v[1] = v[2];
+                n[1] = n[2];
+            }
+        }
+        if (count < 3) return error("f: at least 3 vertices expected");
+    }
+    // Other items (vt, o, g, s, usemtl, mtllib, ...) are ignored.
+    return true;
+}
+
+bool
+rt::ObjReader::parseFaceVertex(const char *&s, unsigned int &v, unsigned int &n) {
+    skipSpaces(s);
+    long i;
+    if (!parseInt(s, i) || !toIndex(i, myFirstVertex, myMesh->vertices.size(), v))
+        return error("f: invalid vertex index");
+    n = TriangleMesh::NO_NORMAL;
+    if (*s == '/') {
+        ++s;
+        // Texture coordinates are ignored.
+        if (*s != '/' && !parseInt(s, i)) return error("f: invalid texture index");
+        if (*s == '/') {
+            ++s;
+            if (!parseInt(s, i) || !toIndex(i, myFirstNormal, myMesh->normals.size(), n))
+                return error("f: invalid normal index");
+        }
+    }
+    if (*s != '\0' && !isSpace(*s)) return error("f: unexpected character");
+    return true;
+}
+
+bool
+rt::ObjReader::toIndex(long i, std::size_t first, std::size_t size, unsigned int &index) const {
+    // Indices start at 1, negative ones are relative to the end.
+    long j = i > 0 ? (long) first + i - 1 : (long) size + i;
+    if (i == 0 || j < (long) first || j >= (long) size) return false;
+    index = (unsigned int) j;
+    return true;
+}
+
+bool
+rt::ObjReader::error(const char *message) const {
+    std::cerr << "ObjReader: line " << myLine << ": " << message << std::endl;
+    return false;
+}
@@ -0,0 +1,69 @@
+/**
+@file ObjReader.h
+*/
+#pragma once
+#ifndef _OBJ_READER_H_
+#define _OBJ_READER_H_
+
+#include <iostream>
+#include <string>
+#include "TriangleMesh.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /**
+  Reads the geometry of a Wavefront OBJ file into a TriangleMesh:
+  vertices (v), normals (vn) and faces (f). Faces may use the forms
+  "v", "v/vt", "v//vn" or "v/vt/vn", with negative indices relative to
+  the last vertex, and polygons are split into triangle fans. Other
+  items (texture coordinates, groups, materials) are ignored.
+
+  Like SceneReader, the file is read by blocks and parsed in place, so
+  that meshes with millions of triangles are read at disk speed.
+  */
+  struct ObjReader {
+    /// Number of bytes read by the last call to read.
+    std::size_t nbBytes;
+    /// Number of triangles read by the last call to read.
+    std::size_t nbTriangles;
+    /// Time spent to parse the file (in seconds).
+    double parseTime;
+    /// Time spent to build the index of the triangles (in seconds).
+    double indexTime;
+
+    /// Default constructor.
+    ObjReader();
+
+    /// Reads the OBJ file \a filename and adds its triangles to \a mesh,
+    /// then builds its index.
+    /// @return 'true' if everything went well, otherwise an error is
+    /// displayed on std::cerr.
+    bool read( TriangleMesh& mesh, const std::string& filename );
+
+    /// Reads an OBJ file from \a input and adds its triangles to \a
+    /// mesh, then builds its index.
+    /// @return 'true' if everything went well, otherwise an error is
+    /// displayed on std::cerr.
+    bool read( TriangleMesh& mesh, std::istream& input );
+
+    /// Displays the statistics of the last read (throughput).
+    void displayStatistics( std::ostream& output ) const;
+
+  private:
+    TriangleMesh* myMesh;
+    /// first vertex and normal of the file in the mesh.
+    std::size_t myFirstVertex, myFirstNormal;
+    std::size_t myLine;
+
+    bool parseLine( const char* s );
+    /// Reads one vertex of a face ("v", "v/vt", "v//vn" or "v/vt/vn").
+    bool parseFaceVertex( const char*& s, unsigned int& v, unsigned int& n );
+    /// Converts an index of the file into an index of the mesh.
+    bool toIndex( long i, std::size_t first, std::size_t size, unsigned int& index ) const;
+    bool error( const char* message ) const;
+  };
+
+} // namespace rt
+
+#endif // #define _OBJ_READER_H_
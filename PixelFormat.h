@@ -0,0 +1,128 @@
+/**
+@file PixelFormat.h
+*/
+#pragma once
+#ifndef _PIXEL_FORMAT_H_
+#define _PIXEL_FORMAT_H_
+
+#include <cstdint>
+#include <cstring>
+#include "Color.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Compact pixel types for Image2D, smaller than Color (12 bytes).
+  /// Each one is built from a (clamped) Color, and gives back its 8 bits
+  /// channels with toRGB8, which is what Image2DWriter writes.
+
+  /// A pixel with 8 bits per channel (3 bytes), converted as
+  /// Image2DWriter<Color> does.
+  struct RGB8 {
+    unsigned char rgb[ 3 ];
+
+    RGB8() { rgb[ 0 ] = rgb[ 1 ] = rgb[ 2 ] = 0; }
+    explicit RGB8( const Color& c )
+    {
+      rgb[ 0 ] = (unsigned char) ( c.r() * 255.0f );
+      rgb[ 1 ] = (unsigned char) ( c.g() * 255.0f );
+      rgb[ 2 ] = (unsigned char) ( c.b() * 255.0f );
+    }
+    void toRGB8( unsigned char* out ) const
+    {
+      out[ 0 ] = rgb[ 0 ]; out[ 1 ] = rgb[ 1 ]; out[ 2 ] = rgb[ 2 ];
+    }
+  };
+
+  /// A pixel with 5 bits of red, 6 bits of green and 5 bits of blue (2
+  /// bytes), for previews.
+  struct RGB565 {
+    std::uint16_t bits;
+
+    RGB565() : bits( 0 ) {}
+    explicit RGB565( const Color& c )
+      : bits( (std::uint16_t) ( ( (unsigned) ( c.r() * 31.0f + 0.5f ) << 11 )
+                                | ( (unsigned) ( c.g() * 63.0f + 0.5f ) << 5 )
+                                | (unsigned) ( c.b() * 31.0f + 0.5f ) ) )
+    {}
+    /// Channels are expanded to 8 bits by repeating their high bits, so
+    /// that 0 and the maximum give 0 and 255.
+    void toRGB8( unsigned char* out ) const
+    {
+      unsigned r = bits >> 11, g = ( bits >> 5 ) & 0x3f, b = bits & 0x1f;
+      out[ 0 ] = (unsigned char) ( ( r << 3 ) | ( r >> 2 ) );
+      out[ 1 ] = (unsigned char) ( ( g << 2 ) | ( g >> 4 ) );
+      out[ 2 ] = (unsigned char) ( ( b << 3 ) | ( b >> 2 ) );
+    }
+  };
+
+  /// @return the half float (IEEE 754 binary16) nearest to \a f.
+  inline std::uint16_t toHalf( float f )
+  {
+    std::uint32_t x;
+    std::memcpy( &x, &f, sizeof( x ) );
+    std::uint32_t sign = ( x >> 16 ) & 0x8000;
+    std::uint32_t m = x & 0x7fffff;
+    int exponent = (int) ( ( x >> 23 ) & 0xff );
+    if ( exponent == 0xff ) // infinity or NaN
+      return (std::uint16_t) ( sign | 0x7c00 | ( m != 0 ? 0x200 : 0 ) );
+    int e = exponent - 127 + 15;
+    if ( e >= 31 ) return (std::uint16_t) ( sign | 0x7c00 );
+    std::uint32_t h, rest, half;
+    if ( e <= 0 ) { // subnormal half
+      if ( e < -10 ) return (std::uint16_t) sign;
+      m |= 0x800000;
+      int shift = 14 - e;
+      h = m >> shift;
+      rest = m & ( ( 1u << shift ) - 1 );
+      half = 1u << ( shift - 1 );
+    } else {
+      h = ( (std::uint32_t) e << 10 ) | ( m >> 13 );
+      rest = m & 0x1fff;
+      half = 0x1000;
+    }
+    // Round to nearest even (a carry may go into the exponent).
+    if ( rest > half || ( rest == half && ( h & 1 ) ) ) ++h;
+    return (std::uint16_t) ( sign | h );
+  }
+
+  /// @return the float of the half float \a h.
+  inline float fromHalf( std::uint16_t h )
+  {
+    std::uint32_t sign = (std::uint32_t) ( h & 0x8000 ) << 16;
+    std::uint32_t e = ( h >> 10 ) & 0x1f;
+    std::uint32_t m = h & 0x3ff;
+    if ( e == 0 ) { // zero or subnormal
+      float f = (float) m * ( 1.0f / 16777216.0f );
+      return sign != 0 ? -f : f;
+    }
+    std::uint32_t x = sign | ( e == 31 ? 0x7f800000 | ( m << 13 )
+                                       : ( ( e + 112 ) << 23 ) | ( m << 13 ) );
+    float f;
+    std::memcpy( &f, &x, sizeof( f ) );
+    return f;
+  }
+
+  /// A pixel with a half float per channel (6 bytes), which keeps 11
+  /// significant bits.
+  struct RGBHalf {
+    std::uint16_t rgb[ 3 ];
+
+    RGBHalf() { rgb[ 0 ] = rgb[ 1 ] = rgb[ 2 ] = 0; }
+    explicit RGBHalf( const Color& c )
+    {
+      rgb[ 0 ] = toHalf( c.r() );
+      rgb[ 1 ] = toHalf( c.g() );
+      rgb[ 2 ] = toHalf( c.b() );
+    }
+    /// @return the color of the pixel.
+    Color color() const
+    {
+      return Color( fromHalf( rgb[ 0 ] ), fromHalf( rgb[ 1 ] ), fromHalf( rgb[ 2 ] ) );
+    }
+    void toRGB8( unsigned char* out ) const { RGB8( color() ).toRGB8( out ); }
+  };
+
+} // namespace rt
+
+#endif // #define _PIXEL_FORMAT_H_
@@ -111,6 +111,31 @@ namespace rt {
     {
       return emission;
     }
+
+    /// @return the direction, distance and color of this light viewed
+    /// from \a p, with a single square root.
+    LightSample sample( const Vector3& p ) const
+    {
+      LightSample s;
+      Vector3 pos( position.data() );
+      if ( position[ 3 ] == 0.0 ) {
+        s.direction = pos / pos.norm();
+        s.distance  = std::numeric_limits<Real>::infinity();
+      } else {
+        pos /= position[ 3 ];
+        pos -= p;
+        s.distance  = pos.norm();
+        s.direction = pos / s.distance;
+      }
+      s.color = emission;
+      return s;
+    }
+
+    /// @return 'true' if w = 0.
+    bool isAtInfinity() const
+    {
+      return position[ 3 ] == 0.0;
+    }
     
   };
 
@@ -0,0 +1,48 @@
+/**
+@file Random.h
+*/
+#pragma once
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include <cstdint>
+#include "PointVector.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A small and fast pseudo-random generator (xorshift), used by the
+  /// stochastic parts of the rendering. It is reseeded for each pixel
+  /// (see seed), so that images do not depend on the order in which
+  /// pixels are computed.
+  struct Random {
+    /// Creates a generator seeded with \a s.
+    explicit Random( std::uint32_t s = 0 ) { seed( s ); }
+
+    /// Restarts the sequence of numbers from the seed \a s. Close seeds
+    /// (e.g. neighbouring pixels) give unrelated sequences.
+    void seed( std::uint32_t s )
+    {
+      // Finalizer of MurmurHash3.
+      s ^= s >> 16; s *= 0x85ebca6bu;
+      s ^= s >> 13; s *= 0xc2b2ae35u;
+      s ^= s >> 16;
+      myState = s != 0 ? s : 0x9e3779b9u;
+    }
+
+    /// @return a number uniformly distributed in [0,1[.
+    Real uniform()
+    {
+      myState ^= myState << 13;
+      myState ^= myState >> 17;
+      myState ^= myState << 5;
+      return (Real) ( myState >> 8 ) * ( 1.0f / 16777216.0f );
+    }
+
+  private:
+    std::uint32_t myState;
+  };
+
+} // namespace rt
+
+#endif // #define _RANDOM_H_
@@ -0,0 +1,335 @@
+/**
+@file RenderServer.cpp
+*/
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "RenderServer.h"
+#include "SceneReader.h"
+#include "Renderer.h"
+#include "WavefrontRenderer.h"
+#include "Image2DWriter.h"
+
+namespace {
+    /// Fills \a address for the socket \a path.
+    bool socketAddress(const std::string &path, sockaddr_un &address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "[RenderServer] Socket path too long: " << path << std::endl;
+            return false;
+        }
+        std::strcpy(address.sun_path, path.c_str());
+        return true;
+    }
+}
+
+rt::RenderServer::CachedScene::~CachedScene() {
+    // The scene goes before its reader.
+    scene.reset();
+    delete background;
+}
+
+bool
+rt::RenderServer::run(const std::string &path) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) return false;
+    int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (server < 0 || ::bind(server, (sockaddr *) &address, sizeof(address)) != 0
+        || ::listen(server, 64) != 0) {
+        std::cerr << "[RenderServer::run] Unable to listen on " << path << ": "
+                  << std::strerror(errno) << std::endl;
+        if (server >= 0) ::close(server);
+        return false;
+    }
+    std::cout << "Listening on " << path << "." << std::endl;
+    // Clients are accepted until none is left waiting.
+    ::fcntl(server, F_SETFL, O_NONBLOCK);
+    myQuit = false;
+    std::vector<pollfd> fds;
+    while (!myQuit || !myJobs.empty()) {
+        // Waits for requests when no job is waiting (at most until the
+        // first deadline), otherwise only takes the ones which came, so
+        // that the job of highest priority is chosen.
+        auto now = std::chrono::steady_clock::now();
+        int timeout = myJobs.empty() ? -1 : 0;
+        for (const PendingClient &c : myClients) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(c.deadline - now).count() + 1;
+            if (timeout < 0 || left < timeout) timeout = (int) std::max<long long>(left, 0);
+        }
+        fds.clear();
+        pollfd fd = {server, POLLIN, 0};
+        fds.push_back(fd);
+        for (const PendingClient &c : myClients) {
+            pollfd client_fd = {c.socket, POLLIN, 0};
+            fds.push_back(client_fd);
+        }
+        if (::poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+            std::cerr << "[RenderServer::run] poll: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        now = std::chrono::steady_clock::now();
+        std::vector<PendingClient> pending;
+        for (std::size_t k = 0; k < myClients.size(); ++k) {
+            PendingClient &c = myClients[k];
+            if (fds[k + 1].revents != 0 && !receive(c)) continue;
+            if (c.deadline <= now) {
+                std::string error = "error no request\n";
+                writeAll(c.socket, error.data(), error.size());
+                ::close(c.socket);
+                continue;
+            }
+            pending.push_back(c);
+        }
+        myClients.swap(pending);
+        // New clients are read at once: their request is often there.
+        int client;
+        while (!myQuit && fds[0].revents != 0 && (client = ::accept(server, 0, 0)) >= 0) {
+            PendingClient c;
+            c.socket = client;
+            c.deadline = now + std::chrono::seconds(REQUEST_TIMEOUT);
+            if (receive(c)) myClients.push_back(c);
+        }
+        if (myJobs.empty()) continue;
+        QueuedJob queued = myJobs.top();
+        myJobs.pop();
+        render(queued.job, queued.socket);
+        ::close(queued.socket);
+    }
+    for (const PendingClient &c : myClients) ::close(c.socket);
+    myClients.clear();
+    ::close(server);
+    ::unlink(path.c_str());
+    return true;
+}
+
+bool
+rt::RenderServer::receive(PendingClient &c) {
+    char buffer[1024];
+    while (true) {
+        ssize_t n = ::recv(c.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) {
+            ::close(c.socket);
+            return false;
+        }
+        c.request.append(buffer, (std::size_t) n);
+        std::size_t end = c.request.find('\n');
+        if (end != std::string::npos) {
+            request(c.socket, c.request.substr(0, end));
+            return false;
+        }
+        if (c.request.size() > MAX_REQUEST) {
+            std::string error = "error request too long\n";
+            writeAll(c.socket, error.data(), error.size());
+            ::close(c.socket);
+            return false;
+        }
+    }
+}
+
+void
+rt::RenderServer::request(int socket, const std::string &line) {
+    QueuedJob queued;
+    if (line == "quit") {
+        myQuit = true;
+        ::close(socket);
+    } else if (parseJob(line, queued.job)) {
+        queued.socket = socket;
+        queued.order = myNbJobs++;
+        myJobs.push(queued);
+    } else {
+        std::string error = "error bad request: " + line + "\n";
+        writeAll(socket, error.data(), error.size());
+        ::close(socket);
+    }
+}
+
+rt::RenderServer::CachedScene *
+rt::RenderServer::scene(const std::string &filename) {
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0) {
+        std::cerr << "[RenderServer::scene] No file " << filename << std::endl;
+        return 0;
+    }
+    auto it = myScenes.find(filename);
+    if (it != myScenes.end() && it->second->mtime == st.st_mtime) {
+        it->second->last_use = ++myClock;
+        return it->second.get();
+    }
+    if (it != myScenes.end()) myScenes.erase(it);
+    // Frees the least recently used scenes first.
+    while (!myScenes.empty() && (int) myScenes.size() >= myMaxScenes) {
+        auto oldest = myScenes.begin();
+        for (auto i = myScenes.begin(); i != myScenes.end(); ++i)
+            if (i->second->last_use < oldest->second->last_use) oldest = i;
+        std::cout << "Scene " << oldest->first << " freed." << std::endl;
+        myScenes.erase(oldest);
+    }
+    std::unique_ptr<CachedScene> cached(new CachedScene);
+    cached->scene.reset(new Scene);
+    cached->mtime = st.st_mtime;
+    if (CompiledSceneReader::isCompiled(filename)) {
+        cached->compiled_reader.reset(new CompiledSceneReader);
+        CompiledSceneReader &reader = *cached->compiled_reader;
+        if (!reader.read(*cached->scene, filename)) return 0;
+        cached->camera = reader.camera;
+        cached->hasCamera = reader.hasCamera;
+        cached->background = reader.background;
+        cached->hasBackground = reader.hasBackground;
+    } else {
+        SceneReader reader;
+        if (!reader.read(*cached->scene, filename)) return 0;
+        cached->camera = reader.camera;
+        cached->hasCamera = reader.hasCamera;
+        cached->background = reader.background;
+        cached->hasBackground = reader.hasBackground;
+    }
+    // Builds the spatial index now, once for all the jobs.
+    cached->scene->update();
+    cached->last_use = ++myClock;
+    std::cout << "Scene " << filename << " loaded." << std::endl;
+    CachedScene *result = cached.get();
+    myScenes[filename] = std::move(cached);
+    return result;
+}
+
+void
+rt::RenderServer::render(const RenderJob &job, int socket) {
+    try {
+        renderImage(job, socket);
+    } catch (const std::bad_alloc &) {
+        std::cerr << "[RenderServer::render] Out of memory for " << job.scene_file << " at "
+                  << job.width << "x" << job.height << "." << std::endl;
+        std::string error = "error out of memory\n";
+        writeAll(socket, error.data(), error.size());
+    }
+}
+
+void
+rt::RenderServer::renderImage(const RenderJob &job, int socket) {
+    CachedScene *cached = scene(job.scene_file);
+    if (cached == 0) {
+        std::string error = "error unable to read " + job.scene_file + "\n";
+        writeAll(socket, error.data(), error.size());
+        return;
+    }
+    std::unique_ptr<Renderer> renderer;
+    if (myWavefront) renderer.reset(new WavefrontRenderer(*cached->scene));
+    else renderer.reset(new Renderer(*cached->scene));
+    if (cached->hasBackground) renderer->ptrBackground = cached->background;
+    renderer->setLightSamples(myLightSamples);
+    renderer->setShadowSamples(myShadowSamples);
+    const Camera &camera = job.hasCamera ? job.camera : cached->camera;
+    Vector3 dirUL, dirUR, dirLL, dirLR;
+    camera.getViewBox(job.width, job.height, dirUL, dirUR, dirLL, dirLR);
+    renderer->setViewBox(camera.position, dirUL, dirUR, dirLL, dirLR);
+    renderer->setResolution(job.width, job.height);
+    Image2D<Color> image(job.width, job.height);
+    renderer->render(image, job.max_depth);
+    std::ostringstream output;
+    output << "ok" << std::endl;
+    Image2DWriter<Color>::write(image, output, false);
+    std::string data = output.str();
+    if (!writeAll(socket, data.data(), data.size()))
+        std::cerr << "[RenderServer::render] The client of " << job.scene_file << " left." << std::endl;
+}
+
+bool
+rt::RenderServer::submit(const std::string &path, const RenderJob &job, std::ostream &output) {
+    sockaddr_un address;
+    if (!socketAddress(path, address)) return false;
+    int client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client < 0 || ::connect(client, (sockaddr *) &address, sizeof(address)) != 0) {
+        std::cerr << "[RenderServer::submit] Unable to connect to " << path << ": "
+                  << std::strerror(errno) << std::endl;
+        if (client >= 0) ::close(client);
+        return false;
+    }
+    std::ostringstream request;
+    request << "render " << job.priority << " " << job.width << " " << job.height << " " << job.max_depth;
+    if (job.hasCamera) {
+        const Camera &c = job.camera;
+        request << " camera " << c.position[0] << " " << c.position[1] << " " << c.position[2]
+                << " " << c.target[0] << " " << c.target[1] << " " << c.target[2]
+                << " " << c.up[0] << " " << c.up[1] << " " << c.up[2] << " " << c.fov;
+    }
+    request << " " << job.scene_file << "\n";
+    std::string line = request.str();
+    std::string status;
+    if (!writeAll(client, line.data(), line.size()) || !readLine(client, status) || status != "ok") {
+        std::cerr << "[RenderServer::submit] " << (status.empty() ? "No answer" : status) << std::endl;
+        ::close(client);
+        return false;
+    }
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = ::recv(client, buffer, sizeof(buffer), 0)) > 0) output.write(buffer, n);
+    ::close(client);
+    return n == 0 && output.good();
+}
+
+bool
+rt::RenderServer::readLine(int socket, std::string &line) {
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t n = ::recv(socket, &c, 1, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+        line += c;
+    }
+}
+
+bool
+rt::RenderServer::writeAll(int socket, const void *data, std::size_t n) {
+    const char *p = (const char *) data;
+    while (n > 0) {
+        // No SIGPIPE when the client left.
+        ssize_t r = ::send(socket, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+bool
+rt::RenderServer::parseJob(const std::string &line, RenderJob &job) {
+    std::istringstream input(line);
+    std::string word;
+    if (!(input >> word) || word != "render"
+        || !(input >> job.priority >> job.width >> job.height >> job.max_depth)
+        || job.width <= 0 || job.height <= 0 || job.width > MAX_SIZE || job.height > MAX_SIZE
+        || job.max_depth < 0 || job.max_depth > MAX_DEPTH)
+        return false;
+    input >> std::ws;
+    std::streampos start = input.tellg();
+    job.hasCamera = (input >> word) && word == "camera";
+    if (job.hasCamera) {
+        Camera &c = job.camera;
+        if (!(input >> c.position[0] >> c.position[1] >> c.position[2]
+                    >> c.target[0] >> c.target[1] >> c.target[2]
+                    >> c.up[0] >> c.up[1] >> c.up[2] >> c.fov))
+            return false;
+        input >> std::ws;
+    } else {
+        input.clear();
+        input.seekg(start);
+    }
+    // The file name is the rest of the line (it may hold spaces).
+    std::getline(input, job.scene_file);
+    return !job.scene_file.empty();
+}
@@ -0,0 +1,177 @@
+/**
+@file RenderServer.h
+*/
+#pragma once
+#ifndef _RENDER_SERVER_H_
+#define _RENDER_SERVER_H_
+
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include "Background.h"
+#include "Camera.h"
+#include "CompiledSceneReader.h"
+#include "Scene.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A render job: a scene file seen from a camera.
+  struct RenderJob {
+    /// Jobs of higher priority are rendered first, then jobs in the
+    /// order they came.
+    int priority = 0;
+    /// The scene file (an absolute path, the server may run elsewhere).
+    std::string scene_file;
+    int width = 640, height = 480, max_depth = 6;
+    /// The camera, replacing the one of the scene file when hasCamera.
+    bool hasCamera = false;
+    Camera camera;
+  };
+
+  /// A process rendering jobs sent on a Unix domain socket, which keeps
+  /// the scenes it loaded (and their spatial indexes) in memory. A job
+  /// on a scene already loaded, e.g. another view of a turntable, thus
+  /// starts rendering at once.
+  ///
+  /// A client connects to the socket and sends a line
+  ///
+  ///   render priority width height depth [camera px py pz tx ty tz ux uy uz fov] scene_file
+  ///
+  /// and receives "ok" and the image as a binary PPM, or "error" and a
+  /// message, on a line. The line "quit" stops the server. Jobs waiting
+  /// are rendered by priority (see RenderJob), one at a time. Images are
+  /// at most MAX_SIZE x MAX_SIZE and depths at most MAX_DEPTH, and a job
+  /// for which memory runs out gets an error instead of stopping the
+  /// server.
+  ///
+  /// Requests are read without blocking, as they come, so that a client
+  /// sending nothing does not hold up the others. It gets an error after
+  /// REQUEST_TIMEOUT seconds without a complete line.
+  ///
+  /// A scene file is read again when it was modified since it was
+  /// loaded. At most myMaxScenes scenes are kept, the least recently
+  /// used ones are freed first.
+  struct RenderServer {
+    /// The largest width and height of the images of jobs.
+    static const int MAX_SIZE = 16384;
+    /// The largest depth of jobs.
+    static const int MAX_DEPTH = 64;
+    /// The time given to a client to send its request line (in seconds).
+    static const int REQUEST_TIMEOUT = 10;
+    /// The longest request line.
+    static const std::size_t MAX_REQUEST = 4096;
+
+    RenderServer() {}
+
+    /// Settings of the renderers (see Renderer).
+    void setLightSamples( int nb ) { myLightSamples = nb; }
+    void setShadowSamples( int nb ) { myShadowSamples = nb; }
+    void setWavefront( bool wavefront ) { myWavefront = wavefront; }
+    /// Sets the number of scenes kept in memory.
+    void setMaxScenes( int nb ) { myMaxScenes = nb; }
+
+    /// Serves the jobs sent on the socket \a path until it receives
+    /// "quit".
+    /// @return 'false' if the socket could not be created.
+    bool run( const std::string& path );
+
+    /// Sends \a job to the server listening on \a path, and writes the
+    /// image it sends back into \a output.
+    /// @return 'true' if it succeeded.
+    static bool submit( const std::string& path, const RenderJob& job, std::ostream& output );
+
+  private:
+    RenderServer( const RenderServer& ) = delete;
+    RenderServer& operator=( const RenderServer& ) = delete;
+
+    /// A scene kept in memory.
+    struct CachedScene {
+      std::unique_ptr<Scene> scene;
+      /// Compiled scenes are mapped by their reader, which must outlive
+      /// the scene (see CompiledSceneReader).
+      std::unique_ptr<CompiledSceneReader> compiled_reader;
+      Camera camera;
+      bool hasCamera = false;
+      Background* background = 0;
+      bool hasBackground = false;
+      /// modification time of the file when it was read
+      std::time_t mtime = 0;
+      /// value of myClock at its last use
+      long last_use = 0;
+
+      CachedScene() {}
+      ~CachedScene();
+      CachedScene( const CachedScene& ) = delete;
+      CachedScene& operator=( const CachedScene& ) = delete;
+    };
+
+    /// A job waiting to be rendered, with the socket of its client.
+    struct QueuedJob {
+      RenderJob job;
+      int socket;
+      /// order of arrival
+      long order;
+      bool operator<( const QueuedJob& other ) const
+      {
+        return job.priority != other.job.priority ? job.priority < other.job.priority
+                                                  : order > other.order;
+      }
+    };
+
+    /// A client whose request line is not complete yet.
+    struct PendingClient {
+      int socket;
+      /// what was received of the line
+      std::string request;
+      /// when the client is dropped if the line is still not complete
+      std::chrono::steady_clock::time_point deadline;
+    };
+
+    int myLightSamples = 0;
+    int myShadowSamples = 8;
+    bool myWavefront = false;
+    int myMaxScenes = 4;
+    std::map<std::string, std::unique_ptr<CachedScene> > myScenes;
+    std::priority_queue<QueuedJob> myJobs;
+    std::vector<PendingClient> myClients;
+    long myClock = 0;
+    /// 'true' once "quit" was received.
+    bool myQuit = false;
+    /// number of jobs received (see QueuedJob::order)
+    long myNbJobs = 0;
+
+    /// @return the scene of \a filename, read if needed, or 0 if it
+    /// could not be read.
+    CachedScene* scene( const std::string& filename );
+    /// Renders \a job and sends the image to \a socket, or an error if
+    /// memory runs out.
+    void render( const RenderJob& job, int socket );
+    /// Same as render, letting std::bad_alloc through.
+    void renderImage( const RenderJob& job, int socket );
+
+    /// Receives what came from the client \a c, without blocking, and
+    /// handles its request once the line is complete.
+    /// @return 'false' when the client is done with (its socket is then
+    /// closed, or queued with its job).
+    bool receive( PendingClient& c );
+    /// Handles the request \a line of the client \a socket: queues its
+    /// job, or replies an error.
+    void request( int socket, const std::string& line );
+
+    /// Reads a line from \a socket (without the end of line).
+    static bool readLine( int socket, std::string& line );
+    /// Writes \a n bytes to \a socket.
+    static bool writeAll( int socket, const void* data, std::size_t n );
+    /// Parses a "render" line.
+    static bool parseJob( const std::string& line, RenderJob& job );
+  };
+
+} // namespace rt
+
+#endif // #define _RENDER_SERVER_H_
@@ -9,7 +9,14 @@
 #include "Color.h"
 #include "Image2D.h"
 #include "Ray.h"
+#include "Background.h"
+#include "Scene.h"
+#include "LightTree.h"
+#include "Random.h"
 #include <math.h>
+#include <limits>
+#include <unordered_map>
+#include <vector>
 
 /// Namespace RayTracer
 namespace rt {
@@ -45,31 +52,6 @@ namespace rt {
         output.flush();
     }
 
-    struct Background {
-        virtual Color backgroundColor(const Ray &ray) = 0;
-    };
-
-    struct BasicBackground : public Background {
-        Color backgroundColor(const Ray &ray) {
-            Color result = Color(0.0f, 0.0f, 0.0f);
-            if (ray.direction[2] >= 0 && ray.direction[2] <= 1.0) {
-                return Color(1.0f, 1.0f, 1.0f) + ray.direction[2] * (Color(0.0f, 0.0f, 1.0f) - Color(1.0f, 1.0f, 1.0f));
-            } else {
-                Real x = -0.5f * ray.direction[0] / ray.direction[2];
-                Real y = -0.5f * ray.direction[1] / ray.direction[2];
-                Real d = sqrt(x * x + y * y);
-                Real t = std::min(d, 30.0f) / 30.0f;
-                x -= floor(x);
-                y -= floor(y);
-                if (((x >= 0.5f) && (y >= 0.5f)) || ((x < 0.5f) && (y < 0.5f)))
-                    result += (1.0f - t) * Color(0.2f, 0.2f, 0.2f) + t * Color(1.0f, 1.0f, 1.0f);
-                else
-                    result += (1.0f - t) * Color(0.4f, 0.4f, 0.4f) + t * Color(1.0f, 1.0f, 1.0f);
-            }
-            return result;
-        }
-    };
-
     /// This structure takes care of rendering a scene.
     struct Renderer {
 
@@ -94,11 +76,74 @@ namespace rt {
 
         int myWidth;
         int myHeight;
+        /// The pixels to render are [myRegionX0,myRegionX1[ x
+        /// [myRegionY0,myRegionY1[ when myHasRegion (see setRegion).
+        bool myHasRegion = false;
+        int myRegionX0 = 0, myRegionY0 = 0, myRegionX1 = 0, myRegionY1 = 0;
+        /// Only the pixels whose value is not 0 are rendered (when not 0).
+        const Image2D<unsigned char> *ptrMask = 0;
+
+        /// Number of lights picked at each shaded point (0: all lights).
+        int myLightSamples = 0;
+        /// The hierarchy over the lights (when myLightSamples > 0).
+        LightTree myLightTree;
+        /// The lights, and their positions and colors, when myLightTree
+        /// was built. It is only built again when they change (e.g. not
+        /// between the frames of a film).
+        std::vector<Light *> myLightTreeLights;
+        std::vector<Real> myLightTreeKey;
+        /// A ray being traced, waiting for the colors of its reflected
+        /// and refracted rays (see trace).
+        struct TraceFrame {
+            /// What remains to be done for the ray.
+            enum Stage { REFLECT, REFLECTED, REFRACT, REFRACTED, SHADE };
+            Ray ray;
+            RayHit hit;
+            Color result;
+            Stage stage;
+        };
+        /// The rays being traced, the eye ray first. It grows with the
+        /// depth of rays and is kept from one pixel to the next.
+        std::vector<TraceFrame> myTraceStack;
+        /// Used to pick lights and points on area lights, reseeded at
+        /// each pixel.
+        Random myRandom;
+        /// Area lights are sampled on a grid of myShadowGrid x
+        /// myShadowGrid strata in penumbrae (see softShadow).
+        int myShadowGrid = 8;
+        /// Number of shadow rays cast toward area lights, and of points
+        /// found in their penumbra, during the last render.
+        long myShadowRays = 0;
+        long myPenumbraPoints = 0;
+        /// Largest difference between the probes of an area light for
+        /// which a point is considered outside its penumbra.
+        static constexpr Real SOFT_SHADOW_EPSILON = 1e-3f;
+        /// A primitive of an object (see RayHit::primitive).
+        struct Occluder {
+            GraphicalObject *object = 0;
+            unsigned int primitive = 0;
+        };
+        /// The last opaque primitive found between a shaded point and
+        /// each light, tested first by the next shadow ray toward the
+        /// light. Each renderer has its own cache, so that renderers
+        /// running in different threads do not share it.
+        std::unordered_map<const Light *, Occluder> myOccluders;
+        /// Number of shadow rays stopped by the cached occluder, and of
+        /// shadow rays that needed a search in the scene, during the last
+        /// render.
+        long myOccluderHits = 0;
+        long myOccluderMisses = 0;
+        /// Tells if all objects of the scene are opaque (myOccluders is
+        /// only used then).
+        bool myOpaqueScene = false;
 
         Renderer() : ptrScene(0) {}
 
         Renderer(Scene &scene) : ptrScene(&scene) {}
 
+        /// Virtual destructor, since other renderers derive from this one.
+        virtual ~Renderer() {}
+
         void setScene(rt::Scene &aScene) { ptrScene = &aScene; }
 
         void setViewBox(Point3 origin,
@@ -115,41 +160,149 @@ namespace rt {
             myHeight = height;
         }
 
+        /// Sets the number of lights picked at each shaded point among
+        /// the lights at finite distance (see LightTree), or 0 to use all
+        /// lights. Lights at infinity are always used. Fewer samples are
+        /// faster but noisier.
+        void setLightSamples(int nb) { myLightSamples = std::max(nb, 0); }
+
+        /// Sets the grid of strata sampled on area lights in penumbrae
+        /// (\a nb x \a nb shadow rays). Outside penumbrae, 4 rays are
+        /// enough.
+        void setShadowSamples(int nb) { myShadowGrid = std::max(nb, 1); }
+
+
+        /// Restricts the rendering to the pixels [x0,x1[ x [y0,y1[. Rays
+        /// are the ones of the whole image (same frustum, same random
+        /// numbers), so that these pixels are the same as in a full
+        /// rendering.
+        void setRegion(int x0, int y0, int x1, int y1) {
+            myHasRegion = true;
+            myRegionX0 = x0;
+            myRegionY0 = y0;
+            myRegionX1 = x1;
+            myRegionY1 = y1;
+        }
 
-        /// The main rendering routine
-        void render(Image2D<Color> &image, int max_depth) {
-            std::cout << "Rendering into image ... might take a while." << std::endl;
-            image = Image2D<Color>(myWidth, myHeight);
-            for (int y = 0; y < myHeight; ++y) {
-                Real ty = (Real) y / (Real) (myHeight - 1);
-                progressBar(std::cout, ty, 1.0);
-                Vector3 dirL = (1.0f - ty) * myDirUL + ty * myDirLL;
-                Vector3 dirR = (1.0f - ty) * myDirUR + ty * myDirLR;
-                dirL /= dirL.norm();
-                dirR /= dirR.norm();
-                for (int x = 0; x < myWidth; ++x) {
-                    Real tx = (Real) x / (Real) (myWidth - 1);
-                    Vector3 dir = (1.0f - tx) * dirL + tx * dirR;
-                    Ray eye_ray = Ray(myOrigin, dir, max_depth);
+        /// Renders all the pixels again.
+        void clearRegion() { myHasRegion = false; }
+
+        /// Restricts the rendering to the pixels whose value in \a mask
+        /// (of the size of the image) is not 0, or to all pixels if \a mask
+        /// is 0. The mask must exist until the next rendering.
+        void setMask(const Image2D<unsigned char> *mask) { ptrMask = mask; }
+
+        /// Gives the bounds [x0,x1[ x [y0,y1[ of the pixels to render: the
+        /// region within the image (empty if it is outside).
+        void region(int &x0, int &y0, int &x1, int &y1) const {
+            x0 = y0 = 0;
+            x1 = myWidth;
+            y1 = myHeight;
+            if (!myHasRegion) return;
+            x0 = std::max(x0, myRegionX0);
+            y0 = std::max(y0, myRegionY0);
+            x1 = std::max(x0, std::min(x1, myRegionX1));
+            y1 = std::max(y0, std::min(y1, myRegionY1));
+        }
+
+        /// @return 'true' if the pixel (x,y), in the region, is rendered
+        /// (see setMask).
+        bool isRendered(int x, int y) const {
+            return ptrMask == 0 || ptrMask->at(x, y) != 0;
+        }
+
+        /// The main rendering routine. Only the pixels of the region and
+        /// the mask are rendered; the other ones keep their value in \a
+        /// image, which is only reset when its size is not the one of the
+        /// rendering.
+        virtual void render(Image2D<Color> &image, int max_depth) {
+            beginRender();
+            if (image.w() != myWidth || image.h() != myHeight)
+                image = Image2D<Color>(myWidth, myHeight);
+            int x0, y0, x1, y1;
+            region(x0, y0, x1, y1);
+            for (int y = y0; y < y1; ++y) {
+                progressBar(std::cout, (Real) (y - y0) / (Real) (y1 - y0), 1.0);
+                for (int x = x0; x < x1; ++x) {
+                    if (!isRendered(x, y)) continue;
+                    myRandom.seed((std::uint32_t) (y * myWidth + x));
+                    Ray eye_ray = eyeRay(x, y, max_depth);
                     Color result = trace(eye_ray);
                     image.at(x, y) = result.clamp();
                 }
             }
+            endRender();
+        }
+
+        /// Prepares the scene, the lights and the statistics for a new
+        /// image (called at the beginning of render).
+        void beginRender() {
+            std::cout << "Rendering into image ... might take a while." << std::endl;
+            // Takes into account objects added, removed or moved since last frame.
+            ptrScene->update();
+            if (myLightSamples > 0) {
+                std::vector<Real> key;
+                for (Light *light : ptrScene->myLights) {
+                    LightSample s = light->sample(Point3(0, 0, 0));
+                    key.insert(key.end(), {s.direction[0], s.direction[1], s.direction[2], s.distance,
+                                           s.color.r(), s.color.g(), s.color.b()});
+                }
+                if (key != myLightTreeKey || ptrScene->myLights != myLightTreeLights) {
+                    myLightTree.build(ptrScene->myLights);
+                    myLightTreeLights = ptrScene->myLights;
+                    myLightTreeKey.swap(key);
+                }
+                std::cout << myLightSamples << " of " << myLightTree.size()
+                          << " lights sampled at each point." << std::endl;
+            }
+            myShadowRays = 0;
+            myPenumbraPoints = 0;
+            // Objects may have moved since last frame.
+            myOccluders.clear();
+            myOccluderHits = 0;
+            myOccluderMisses = 0;
+            myOpaqueScene = true;
+            for (GraphicalObject *obj : ptrScene->myObjects)
+                myOpaqueScene = myOpaqueScene && obj->isOpaque();
+        }
+
+        /// Displays the statistics of the image (called at the end of
+        /// render).
+        void endRender() {
             std::cout << "Done." << std::endl;
+            if (myShadowRays > 0)
+                std::cout << myShadowRays << " shadow rays toward area lights, "
+                          << myPenumbraPoints << " points in penumbrae." << std::endl;
+            if (myOccluderHits + myOccluderMisses > 0)
+                std::cout << myOccluderHits << " of " << myOccluderHits + myOccluderMisses
+                          << " shadow rays stopped by the cached occluder ("
+                          << (100 * myOccluderHits) / (myOccluderHits + myOccluderMisses)
+                          << "%)." << std::endl;
         }
 
+        /// @return the ray from the eye through the pixel (x,y), of depth max_depth.
+        Ray eyeRay(int x, int y, int max_depth) const {
+            Real ty = (Real) y / (Real) (myHeight - 1);
+            Vector3 dirL = (1.0f - ty) * myDirUL + ty * myDirLL;
+            Vector3 dirR = (1.0f - ty) * myDirUR + ty * myDirLR;
+            dirL /= dirL.norm();
+            dirR /= dirR.norm();
+            Real tx = (Real) x / (Real) (myWidth - 1);
+            Vector3 dir = (1.0f - tx) * dirL + tx * dirR;
+            return Ray(myOrigin, dir, max_depth);
+        }
 
         // Affiche les sources de lumières avant d'appeler la fonction qui
         // donne la couleur de fond.
         Color background(const Ray &ray) {
             Color result = Color(0.0, 0.0, 0.0);
             for (Light *light : ptrScene->myLights) {
-                Real cos_a = light->direction(ray.origin).dot(ray.direction);
-                if (cos_a > 0.99f) {
-                    Real a = acos(cos_a) * 360.0 / M_PI / 8.0;
-                    a = std::max(1.0f - a, 0.0f);
-                    result += light->color(ray.origin) * a * a;
-                }
+                // Already in the table of an environment map.
+                if (ptrBackground != 0 && ptrBackground->includesLight(light)) continue;
+                LightSample s = light->sample(ray.origin);
+                Real cos_a = s.direction.dot(ray.direction);
+                if (cos_a > 0.99f)
+                    result += s.color * Light::discIntensity(cos_a);
             }
             if (ptrBackground != 0) result += ptrBackground->backgroundColor(ray);
             return result;
@@ -157,62 +310,198 @@ namespace rt {
 
         /// The rendering routine for one ray.
         /// @return the color for the given ray.
+        ///
+        /// The reflected and refracted rays are traced without recursion:
+        /// the rays waiting for the colors of their reflected and
+        /// refracted rays are kept in myTraceStack. Colors are combined
+        /// in the same order as a recursive trace would, so images are
+        /// the same.
         Color trace(const Ray &ray) {
             assert(ptrScene != 0);
-            Color result = Color(0.0, 0.0, 0.0);
-            GraphicalObject *obj_i = 0; // pointer to intersected object
-            Point3 p_i;       // point of intersection
-
-            // Look for intersection in this direction.
-            Real ri = ptrScene->rayIntersection(ray, obj_i, p_i);
-            // Nothing was intersected
-            if (ri >= 0.0f) return background(ray); // some background color
-            if (ray.depth > 0 && obj_i->getMaterial(p_i).coef_reflexion != 0) {
-                Ray ray_reflect(ray.origin, reflect(ray.direction, obj_i->getNormal(p_i)));
-                ray_reflect.depth--;
-                Color color_reflect = trace(ray_reflect);
-                result += color_reflect * obj_i->getMaterial(p_i).specular * obj_i->getMaterial(p_i).coef_reflexion;
-            }
-            if (ray.depth > 0 && obj_i->getMaterial(p_i).coef_refraction != 0) {
-                Ray ray_refract = refractionRay(ray, p_i, obj_i->getNormal(p_i), obj_i->getMaterial(p_i));
-                ray_refract.depth--;
-                Color color_refract = trace(ray_refract);
-                result += color_refract * obj_i->getMaterial(p_i).diffuse * obj_i->getMaterial(p_i).coef_refraction;
+            // Each ray has a smaller depth than the ray it comes from.
+            std::size_t needed = (std::size_t) std::max(ray.depth, 0) + 1;
+            if (myTraceStack.size() < needed) myTraceStack.resize(needed);
+            TraceFrame *stack = myTraceStack.data();
+            int top = -1;           // the ray being processed
+            Color color;            // color of the last ray done
+            Ray child = ray;        // the next ray to trace
+            bool has_child = true;
+            for (;;) {
+                if (has_child) {
+                    has_child = false;
+                    TraceFrame &f = stack[top + 1];
+                    GraphicalObject *obj_i = 0; // pointer to intersected object
+                    // Look for intersection in this direction.
+                    Real ri = ptrScene->rayIntersection(child, obj_i, f.hit);
+                    if (ri >= 0.0f) {
+                        // Nothing was intersected
+                        color = background(child); // some background color
+                        if (top < 0) return color;
+                    } else {
+                        f.ray = child;
+                        f.result = Color(0.0, 0.0, 0.0);
+                        f.stage = TraceFrame::REFLECT;
+                        ++top;
+                    }
+                }
+                TraceFrame &f = stack[top];
+                const Material &m = f.hit.material;
+                switch (f.stage) {
+                    case TraceFrame::REFLECT:
+                        if (f.ray.depth > 0 && m.coef_reflexion != 0) {
+                            child = Ray(f.ray.origin, reflect(f.ray.direction, f.hit.normal));
+                            child.depth--;
+                            has_child = true;
+                            f.stage = TraceFrame::REFLECTED;
+                            break;
+                        }
+                        f.stage = TraceFrame::REFRACT;
+                        break;
+                    case TraceFrame::REFLECTED:
+                        f.result += color * m.specular * m.coef_reflexion;
+                        f.stage = TraceFrame::REFRACT;
+                        break;
+                    case TraceFrame::REFRACT:
+                        if (f.ray.depth > 0 && m.coef_refraction != 0) {
+                            child = refractionRay(f.ray, f.hit.point, f.hit.normal, m);
+                            child.depth--;
+                            has_child = true;
+                            f.stage = TraceFrame::REFRACTED;
+                            break;
+                        }
+                        f.stage = TraceFrame::SHADE;
+                        break;
+                    case TraceFrame::REFRACTED:
+                        f.result += color * m.diffuse * m.coef_refraction;
+                        f.stage = TraceFrame::SHADE;
+                        break;
+                    case TraceFrame::SHADE:
+                        if (f.ray.depth > 0)
+                            f.result += illumination(f.ray, f.hit) * m.coef_diffusion;
+                        else
+                            f.result += illumination(f.ray, f.hit);
+                        color = f.result;
+                        if (--top < 0) return color;
+                        break;
+                }
             }
-            if(ray.depth > 0)
-                result += illumination(ray, obj_i, p_i) * obj_i->getMaterial(p_i).coef_diffusion;
-            else
-                result += illumination(ray, obj_i, p_i);
-            return result;
         }
 
-        /// Calcule l'illumination de l'objet obj au point p, sachant que l'observateur est le rayon ray.
-        Color illumination(const Ray &ray, GraphicalObject *obj, Point3 p) {
+        /// Calcule l'illumination au point d'intersection hit, sachant que l'observateur est le rayon ray.
+        Color illumination(const Ray &ray, const RayHit &hit) {
             Color result = Color(0.0, 0.0, 0.0);
-            Color temp_light_color;
-            // Get all light source
-            for (auto &light : ptrScene->myLights) {
-                temp_light_color = light->color(p);
-                temp_light_color = shadow(Ray(p, light->direction(p)), temp_light_color);
-                // get the diffusion diffusion_coefficient base on the Phong model
-                Real diffusion_coefficient = light->direction(p).dot(obj->getNormal(p));
-                if (diffusion_coefficient < 0) diffusion_coefficient = 0;
-                result += diffusion_coefficient * obj->getMaterial(p).diffuse * temp_light_color;
-
-                // get the specular color base on the Phong model
-                Vector3 reflect_vector = reflect(ray.direction, obj->getNormal(p));
-                Real specular_component = light->direction(p).dot(reflect_vector);
-                if (specular_component >= 0) {
-                    specular_component = powf(specular_component, obj->getMaterial(p).shinyness);
-                    result += specular_component * obj->getMaterial(p).specular * temp_light_color;
+            const Material &m = hit.material;
+            Vector3 reflect_vector = reflect(ray.direction, hit.normal);
+            if (myLightSamples > 0 && myLightTree.size() > myLightSamples) {
+                // Many lights: a few ones are picked in the tree, and their
+                // contribution is divided by their probability.
+                for (Light *light : myLightTree.unclustered())
+                    addLight(*light, hit, reflect_vector, 1.0f, result);
+                for (int k = 0; k < myLightSamples; ++k) {
+                    Real pdf;
+                    Light *light = myLightTree.sample(hit.point, hit.normal, myRandom.uniform(), pdf);
+                    if (light != 0)
+                        addLight(*light, hit, reflect_vector, 1.0f / (pdf * myLightSamples), result);
                 }
+            } else {
+                // Get all light source
+                for (auto &light : ptrScene->myLights)
+                    addLight(*light, hit, reflect_vector, 1.0f, result);
             }
             // add the ambiance color
-            result += obj->getMaterial(p).ambient;
+            result += m.ambient;
 
             return result;
         }
 
+        /// Ajoute à result la contribution de la lumière light au point
+        /// hit (diffuse et spéculaire, avec son ombre), multipliée par
+        /// weight. reflect_vector est la direction de l'observateur
+        /// réfléchie selon la normale.
+        void addLight(const Light &light, const RayHit &hit,
+                      const Vector3 &reflect_vector, Real weight, Color &result) {
+            const Point3 &p = hit.point;
+            LightSample s = light.sample(p);
+            Color temp_light_color = light.hasArea()
+                                     ? softShadow(light, p)
+                                     : shadow(Ray(p, s.direction), s.color, s.distance, &light);
+            addPhong(hit, reflect_vector, s, temp_light_color * weight, result);
+        }
+
+        /// Ajoute à result les termes diffus et spéculaire (modèle de
+        /// Phong) au point hit de la lumière temp_light_color venant de la
+        /// direction de s.
+        static void addPhong(const RayHit &hit, const Vector3 &reflect_vector,
+                             const LightSample &s, const Color &temp_light_color, Color &result) {
+            const Material &m = hit.material;
+            // get the diffusion diffusion_coefficient base on the Phong model
+            Real diffusion_coefficient = s.direction.dot(hit.normal);
+            if (diffusion_coefficient < 0) diffusion_coefficient = 0;
+            result += diffusion_coefficient * m.diffuse * temp_light_color;
+
+            // get the specular color base on the Phong model
+            Real specular_component = s.direction.dot(reflect_vector);
+            if (specular_component >= 0) {
+                specular_component = powf(specular_component, m.shinyness);
+                result += specular_component * m.specular * temp_light_color;
+            }
+        }
+
+        /// Calcule la lumière de la source étendue light qui arrive en p,
+        /// en moyennant l'ombre de points pris sur la source : un point
+        /// tiré au hasard dans chaque case d'une grille myShadowGrid x
+        /// myShadowGrid sur [0,1]^2 (échantillonnage stratifié). On tire
+        /// d'abord une case par quart de la grille : si ces 4 sondes
+        /// donnent la même lumière, p est entièrement éclairé ou dans
+        /// l'ombre, et on s'arrête là. Sinon p est dans la pénombre et on
+        /// tire toutes les autres cases.
+        Color softShadow(const Light &light, const Point3 &p) {
+            const int n = myShadowGrid;
+            const int h = (n + 1) / 2;
+            // One probe per quarter of the grid, in its stratum (i, j).
+            int probes[4][2];
+            for (int q = 0; q < 4; ++q) {
+                int i0 = (q & 1) ? h : 0, i1 = (q & 1) ? n : h;
+                int j0 = (q & 2) ? h : 0, j1 = (q & 2) ? n : h;
+                if (i0 == i1) i0 = 0; // n == 1
+                if (j0 == j1) j0 = 0;
+                probes[q][0] = i0 + std::min((int) (myRandom.uniform() * (i1 - i0)), i1 - i0 - 1);
+                probes[q][1] = j0 + std::min((int) (myRandom.uniform() * (j1 - j0)), j1 - j0 - 1);
+            }
+            Color probe_colors[4];
+            Color total(0.0f, 0.0f, 0.0f);
+            bool agree = true;
+            for (int q = 0; q < 4; ++q) {
+                probe_colors[q] = shadowSample(light, p, probes[q][0], probes[q][1]);
+                total += probe_colors[q];
+                if (q > 0 && distance(probe_colors[q], probe_colors[0]) > SOFT_SHADOW_EPSILON)
+                    agree = false;
+            }
+            myShadowRays += 4;
+            if (agree || n <= 2) return total * 0.25f;
+            // Penumbra: the probes stand for their strata, all others are
+            // sampled too.
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j) {
+                    bool probed = false;
+                    for (int q = 0; q < 4; ++q)
+                        probed = probed || (probes[q][0] == i && probes[q][1] == j);
+                    if (!probed) total += shadowSample(light, p, i, j);
+                }
+            myShadowRays += n * n - 4;
+            ++myPenumbraPoints;
+            return total * (1.0f / (Real) (n * n));
+        }
+
+        /// Calcule l'ombre d'un point tiré au hasard dans la case (i, j)
+        /// de la grille myShadowGrid x myShadowGrid de la source light.
+        Color shadowSample(const Light &light, const Point3 &p, int i, int j) {
+            Real u = ((Real) i + myRandom.uniform()) / (Real) myShadowGrid;
+            Real v = ((Real) j + myRandom.uniform()) / (Real) myShadowGrid;
+            LightSample s = light.sample(p, u, v);
+            return shadow(Ray(p, s.direction), s.color, s.distance, &light);
+        }
+
         /// Calcule le vecteur réfléchi à W selon la normale N.
         Vector3 reflect(const Vector3 &W, Vector3 N) const {
             return W - 2 * W.dot(N) * N;
@@ -251,26 +540,67 @@ namespace rt {
         /// direction donnée par le rayon. Si aucun objet n'est traversé,
         /// retourne light_color, sinon si un des objets traversés est opaque,
         /// retourne du noir, et enfin si les objets traversés sont
-        /// transparents, attenue la couleur.
-        Color shadow(const Ray &ray, Color light_color) {
+        /// transparents, attenue la couleur. Seuls les objets à moins de
+        /// light_distance de l'origine du rayon sont pris en compte.
+        ///
+        /// Si light est donnée, on teste d'abord la dernière primitive
+        /// qui a caché cette lumière (voir myOccluders) : des points
+        /// voisins sont le plus souvent cachés par le même objet, et on
+        /// évite alors de parcourir la scène. Ce n'est fait que si tous
+        /// les objets sont opaques : la recherche dans la scène saute
+        /// l'unité qui suit chaque objet transparent, et pourrait ne pas
+        /// voir la primitive, ce qui rendrait l'image dépendante de
+        /// l'ordre des rayons.
+        Color shadow(const Ray &ray, Color light_color,
+                     Real light_distance = std::numeric_limits<Real>::infinity(),
+                     const Light *light = 0) {
             Color c = light_color;
             Ray p_ray = ray;
             GraphicalObject *obj = 0; // pointer to intersected object
-            Point3 intersection_point;       // point of intersection
+            RayHit hit;       // point of intersection
+            Real remaining = light_distance; // distance to the light from p_ray.origin
+            Occluder *occluder = 0;
+            if (light != 0 && myOpaqueScene) {
+                occluder = &myOccluders[light];
+                if (occluder->object != 0 && isOccludedBy(*occluder, ray, light_distance)) {
+                    ++myOccluderHits;
+                    return Color(0.0f, 0.0f, 0.0f);
+                }
+                ++myOccluderMisses;
+            }
             while (c.max() > 0.003f) {
                 p_ray.origin += ray.direction;
-                Real ri = ptrScene->rayIntersection(p_ray, obj, intersection_point);
+                remaining -= 1.0f;
+                if (remaining <= 0.0f) break;
+                Real ri = ptrScene->rayIntersection(p_ray, obj, hit, remaining);
                 // intersection
                 if (ri < 0.0f) {
-                    c = c * obj->getMaterial(intersection_point).coef_refraction *
-                        obj->getMaterial(intersection_point).diffuse;
-                    p_ray.origin = intersection_point;
+                    c = c * hit.material.coef_refraction * hit.material.diffuse;
+                    remaining += ri;
+                    p_ray.origin = hit.point;
+                    if (occluder != 0 && hit.material.isOpaque()) {
+                        occluder->object = obj;
+                        occluder->primitive = hit.primitive;
+                    }
                 } else {
                     break;
                 }
             }
             return c;
         }
+
+        /// @return 'true' if the primitive of occluder hides the point at
+        /// light_distance along ray with an opaque material (the first
+        /// unit of the ray is skipped, as in shadow).
+        static bool isOccludedBy(const Occluder &occluder, const Ray &ray, Real light_distance) {
+            if (light_distance <= 1.0f) return false;
+            Ray p_ray = ray;
+            p_ray.origin += ray.direction;
+            RayHit hit;
+            return occluder.object->primitiveIntersection(p_ray, occluder.primitive, hit) <= 0.0f
+                   && rt::distance(p_ray.origin, hit.point) < light_distance - 1.0f
+                   && hit.material.isOpaque();
+        }
     };
 
 } // namespace rt
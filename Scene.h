@@ -8,8 +8,12 @@
 
 #include <cassert>
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
 #include "GraphicalObject.h"
 #include "Light.h"
+#include "BVH.h"
 
 /// Namespace RayTracer
 namespace rt {
@@ -19,6 +23,13 @@ namespace rt {
     (could be a tree, but we keep a list for now for the sake of
     simplicity).
 
+    Ray intersections are accelerated by a bounding volume hierarchy
+    over the bounded objects. It is maintained incrementally by
+    update(): added and removed objects are inserted into / removed from
+    it, and moved objects (see objectMoved()) have their boxes refitted.
+    It is rebuilt from scratch only when its quality has degraded by
+    more than myRebuildThreshold.
+
     @note Once the scene receives a new object, it owns the object and
     is thus responsible for its deallocation.
     */
@@ -28,9 +39,12 @@ namespace rt {
         std::vector<Light *> myLights;
         /// The list of objects modelled as a vector.
         std::vector<GraphicalObject *> myObjects;
+        /// The index is rebuilt when its SAH cost exceeds this factor
+        /// times its cost just after the previous build.
+        Real myRebuildThreshold;
 
         /// Default constructor. Nothing to do.
-        Scene() {}
+        Scene() : myRebuildThreshold(1.5f) {}
 
         /// Destructor. Frees objects.
         ~Scene() {
@@ -66,6 +80,80 @@ namespace rt {
         /// Adds a new object to the scene.
         void addObject(GraphicalObject *anObject) {
             myObjects.push_back(anObject);
+            myAddedObjects.push_back(anObject);
+        }
+
+        /// Removes the object from the scene. The caller is then
+        /// responsible for its deallocation.
+        void removeObject(GraphicalObject *anObject) {
+            eraseFrom(myObjects, anObject);
+            eraseFrom(myAddedObjects, anObject);
+            eraseFrom(myMovedObjects, anObject);
+            auto it = myLeaves.find(anObject);
+            if (it != myLeaves.end()) {
+                myIndex.remove(it->second);
+                myLeaves.erase(it);
+            } else
+                eraseFrom(myUnboundedObjects, anObject);
+        }
+
+        /// Must be called when an object of the scene has moved or
+        /// changed its shape, so that its box is refitted at next update().
+        void objectMoved(GraphicalObject *anObject) {
+            myMovedObjects.push_back(anObject);
+        }
+
+        /// Brings the spatial index up to date with the objects added,
+        /// removed or moved since the last call. The cost is proportional
+        /// to the number of changes, unless the quality of the index has
+        /// degraded too much, in which case it is rebuilt.
+        void update() {
+            if (myAddedObjects.empty() && myMovedObjects.empty()) return;
+            // Building is faster and better than inserting many objects.
+            if (myAddedObjects.size() > myLeaves.size() / 2) {
+                rebuild();
+                return;
+            }
+            for (GraphicalObject *obj : myMovedObjects) {
+                auto it = myLeaves.find(obj);
+                if (it != myLeaves.end()) myIndex.refit(it->second, obj->getBoundingBox());
+            }
+            for (GraphicalObject *obj : myAddedObjects) {
+                BoundingBox box = obj->getBoundingBox();
+                if (box.isBounded()) myLeaves[obj] = myIndex.insert(obj, box);
+                else myUnboundedObjects.push_back(obj);
+            }
+            myAddedObjects.clear();
+            myMovedObjects.clear();
+            if (myIndex.needsRebuild(myRebuildThreshold)) rebuild();
+        }
+
+        /// Rebuilds the spatial index from scratch.
+        void rebuild() {
+            std::vector<GraphicalObject *> objects;
+            std::vector<BoundingBox> boxes;
+            std::vector<int> leaves;
+            myUnboundedObjects.clear();
+            for (GraphicalObject *obj : myObjects) {
+                BoundingBox box = obj->getBoundingBox();
+                if (!box.isBounded()) {
+                    myUnboundedObjects.push_back(obj);
+                    continue;
+                }
+                objects.push_back(obj);
+                boxes.push_back(box);
+            }
+            myIndex.build(objects, boxes, leaves);
+            myLeaves.clear();
+            for (std::size_t i = 0; i < objects.size(); ++i)
+                myLeaves[objects[i]] = leaves[i];
+            myAddedObjects.clear();
+            myMovedObjects.clear();
+        }
+
+        /// @return 'true' if there is no pending change for update().
+        bool isUpToDate() const {
+            return myAddedObjects.empty() && myMovedObjects.empty();
         }
 
         /// Adds a new light to the scene.
@@ -75,26 +163,68 @@ namespace rt {
 
         /// returns the closest object intersected by the given ray.
         Real rayIntersection(const Ray &ray, GraphicalObject *&object, Point3 &p) {
-            Point3 pointTemp;
-            Real distance = 0;
-            bool first_intersection = false;
-            for (auto &object_in_list : this->myObjects) {
-                if (object_in_list->rayIntersection(ray, pointTemp) <= 0) {
+            RayHit hit;
+            Real ri = rayIntersection(ray, object, hit);
+            if (ri < 0.0f) p = hit.point;
+            return ri;
+        }
+
+        /// returns the closest object intersected by the given ray, and
+        /// in \a hit the point of intersection, the normal and the
+        /// material there. Only objects closer than \a tmax to the
+        /// origin of the ray are considered.
+        Real rayIntersection(const Ray &ray, GraphicalObject *&object, RayHit &hit,
+                             Real tmax = std::numeric_limits<Real>::infinity()) {
+            assert(isUpToDate());
+            ClosestObject closest(ray, object, hit);
+            Real distance = tmax;
+            for (GraphicalObject *obj : myUnboundedObjects)
+                closest(obj, distance);
+            myIndex.closest(ray, distance, closest);
+            return closest.found ? -distance : 0.0f;
+        }
+
+    private:
+        /// The spatial index over bounded objects.
+        BVH<GraphicalObject *> myIndex;
+        /// The leaf of each object of myIndex.
+        std::unordered_map<GraphicalObject *, int> myLeaves;
+        /// Objects without bounding box, tested against every ray.
+        std::vector<GraphicalObject *> myUnboundedObjects;
+        /// Objects added since last update().
+        std::vector<GraphicalObject *> myAddedObjects;
+        /// Objects moved since last update().
+        std::vector<GraphicalObject *> myMovedObjects;
+
+        /// Used by rayIntersection to keep the closest object hit.
+        struct ClosestObject {
+            const Ray &ray;
+            GraphicalObject *&object;
+            RayHit &hit;
+            bool found;
+
+            ClosestObject(const Ray &aRay, GraphicalObject *&anObject, RayHit &aHit)
+                    : ray(aRay), object(anObject), hit(aHit), found(false) {}
+
+            void operator()(GraphicalObject *obj, Real &distance) {
+                RayHit hitTemp;
+                if (obj->rayIntersection(ray, hitTemp) <= 0) {
                     // get the distance between the ray origin and the intersection point
-                    Real distanceTemp = rt::distance(ray.origin, pointTemp);
-                    if (distanceTemp < distance || !first_intersection) {
+                    Real distanceTemp = rt::distance(ray.origin, hitTemp.point);
+                    if (distanceTemp < distance) {
                         distance = distanceTemp;
-                        object = object_in_list;
-                        p = pointTemp;
-                        first_intersection = true;
+                        object = obj;
+                        hit = hitTemp;
+                        found = true;
                     }
                 }
             }
+        };
 
-            return first_intersection ? -distance : distance;
+        static void eraseFrom(std::vector<GraphicalObject *> &objects, GraphicalObject *obj) {
+            objects.erase(std::remove(objects.begin(), objects.end(), obj), objects.end());
         }
 
-    private:
         /// Copy constructor is forbidden.
         Scene(const Scene &) = delete;
 
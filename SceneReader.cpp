@@ -0,0 +1,271 @@
+/**
+@file SceneReader.cpp
+*/
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include "SceneReader.h"
+#include "TextParser.h"
+#include "ObjReader.h"
+#include "Instance.h"
+#include "PointLight.h"
+#include "AreaLight.h"
+#include "Image2DReader.h"
+
+using namespace rt::TextParser;
+
+rt::SceneReader::SceneReader()
+        : hasCamera(false), background(0), hasBackground(false), spheres(0),
+          nbBytes(0), nbPrimitives(0), parseTime(0.0), indexTime(0.0),
+          myLastMaterial(-1), mySpheres(0), myNbLights(0), myLine(0), myMeshBytes(0) {}
+
+bool
+rt::SceneReader::read(Scene &scene, const std::string &filename) {
+    std::ifstream input(filename.c_str(), std::ios::binary);
+    if (!input.good()) {
+        std::cerr << "SceneReader: unable to open " << filename << std::endl;
+        return false;
+    }
+    std::size_t slash = filename.find_last_of('/');
+    myDirectory = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+    bool ok = read(scene, input);
+    myDirectory.clear();
+    return ok;
+}
+
+bool
+rt::SceneReader::read(Scene &scene, std::istream &input) {
+    auto t0 = std::chrono::steady_clock::now();
+    myMaterials.clear();
+    addMaterial("whitePlastic", 12, Material::whitePlastic());
+    addMaterial("redPlastic", 10, Material::redPlastic());
+    addMaterial("bronze", 6, Material::bronze());
+    addMaterial("emerald", 7, Material::emerald());
+    addMaterial("glass", 5, Material::glass());
+    myLastMaterial = -1;
+    spheres = 0;
+    files.clear();
+    mySpheres = new SphereSet;
+    myNbLights = 0;
+    myLine = 0;
+    nbBytes = 0;
+    nbPrimitives = 0;
+    indexTime = 0.0;
+    myMeshBytes = 0;
+    myObjects.clear();
+
+    auto parse_line = [this, &scene](const char *line) { return parseLine(scene, line); };
+    bool ok = readLines(input, nbBytes, parse_line);
+    nbBytes += myMeshBytes;
+    auto t1 = std::chrono::steady_clock::now();
+    if (ok && !mySpheres->elements.empty()) {
+        mySpheres->buildIndex();
+        scene.addObject(mySpheres);
+        spheres = mySpheres;
+    } else
+        delete mySpheres;
+    mySpheres = 0;
+    auto t2 = std::chrono::steady_clock::now();
+    // Meshes were indexed while they were read.
+    parseTime = std::chrono::duration<double>(t1 - t0).count() - indexTime;
+    indexTime += std::chrono::duration<double>(t2 - t1).count();
+    return ok;
+}
+
+void
+rt::SceneReader::displayStatistics(std::ostream &output) const {
+    double mb = nbBytes / 1e6;
+    output << "Read " << nbPrimitives << " primitives (" << mb << " MB) in "
+           << parseTime << " s: " << (parseTime > 0.0 ? nbPrimitives / parseTime : 0.0)
+           << " primitives/s, " << (parseTime > 0.0 ? mb / parseTime : 0.0) << " MB/s."
+           << " Index built in " << indexTime << " s." << std::endl;
+}
+
+bool
+rt::SceneReader::parseLine(Scene &scene, const char *s) {
+    ++myLine;
+    const char *word;
+    std::size_t length = token(s, word);
+    if (length == 0 || *word == '#') return true;
+    if (matches(word, length, "sphere") || matches(word, length, "bubble")) {
+        bool bubble = *word == 'b';
+        Real v[4];
+        if (!parseReals(s, v, 4)) return error("sphere: x y z radius expected");
+        int m = findMaterial(s);
+        if (m < 0) return error("sphere: unknown material");
+        NamedMaterial &nm = myMaterials[m];
+        if (nm.index < 0) nm.index = (int) mySpheres->addMaterial(nm.material);
+        // Same as addBubble: a thin shell.
+        if (bubble) mySpheres->addShell(Point3(v[0], v[1], v[2]), v[3], BUBBLE_THICKNESS, nm.index);
+        else mySpheres->addSphere(Point3(v[0], v[1], v[2]), v[3], nm.index);
+        ++nbPrimitives;
+    } else if (matches(word, length, "material")) {
+        const char *name;
+        std::size_t name_length = token(s, name);
+        if (name_length == 0 || name_length >= NAME_SIZE) return error("material: invalid name");
+        const char *next = s;
+        Real v[15];
+        if (parseReals(next, v, 15)) {
+            addMaterial(name, name_length,
+                        Material(Color(v[0], v[1], v[2]), Color(v[3], v[4], v[5]),
+                                 Color(v[6], v[7], v[8]), v[9], v[10], v[11], v[12], v[13], v[14]));
+            s = next;
+        } else {
+            int m = findMaterial(s);
+            if (m < 0) return error("material: 15 numbers or a known material expected");
+            addMaterial(name, name_length, myMaterials[m].material);
+        }
+    } else if (matches(word, length, "mesh")) {
+        TriangleMesh *mesh = readMesh(s);
+        if (mesh == 0) return false;
+        scene.addObject(mesh);
+    } else if (matches(word, length, "object")) {
+        const char *name;
+        std::size_t name_length = token(s, name);
+        if (name_length == 0) return error("object: name expected");
+        TriangleMesh *mesh = readMesh(s);
+        if (mesh == 0) return false;
+        myObjects.push_back(std::make_pair(std::string(name, name_length),
+                                           std::shared_ptr<GraphicalObject>(mesh)));
+    } else if (matches(word, length, "instance")) {
+        const char *name;
+        std::size_t name_length = token(s, name);
+        int o = (int) myObjects.size() - 1;
+        while (o >= 0 && !matches(name, name_length, myObjects[o].first.c_str())) --o;
+        if (o < 0) return error("instance: unknown object");
+        Real v[8];
+        if (!parseReals(s, v, 3)) return error("instance: tx ty tz expected");
+        Transform t = Transform::translation(Vector3(v[0], v[1], v[2]));
+        if (!isEnd(s)) {
+            if (!parseReal(s, v[3])) return error("instance: scale expected");
+            Transform r;
+            if (!isEnd(s)) {
+                if (!parseReals(s, v + 4, 4)) return error("instance: ax ay az angle expected");
+                r = Transform::rotation(Vector3(v[4], v[5], v[6]), v[7]);
+            }
+            t = t * r * Transform::scaling(Vector3(v[3], v[3], v[3]));
+        }
+        scene.addObject(new Instance(myObjects[o].second, t));
+        ++nbPrimitives;
+    } else if (matches(word, length, "light")) {
+        Real v[7];
+        if (!parseReals(s, v, 7)) return error("light: x y z w r g b expected");
+        scene.addLight(new PointLight(GL_LIGHT0 + myNbLights++, Point4(v[0], v[1], v[2], v[3]),
+                                      Color(v[4], v[5], v[6])));
+        ++nbPrimitives;
+    } else if (matches(word, length, "rectlight")) {
+        Real v[12];
+        if (!parseReals(s, v, 12)) return error("rectlight: center side_u side_v r g b expected");
+        scene.addLight(new RectangleLight(GL_LIGHT0 + myNbLights++, Point3(v[0], v[1], v[2]),
+                                          Vector3(v[3], v[4], v[5]), Vector3(v[6], v[7], v[8]),
+                                          Color(v[9], v[10], v[11])));
+        ++nbPrimitives;
+    } else if (matches(word, length, "spherelight")) {
+        Real v[7];
+        if (!parseReals(s, v, 7)) return error("spherelight: x y z radius r g b expected");
+        scene.addLight(new SphereLight(GL_LIGHT0 + myNbLights++, Point3(v[0], v[1], v[2]), v[3],
+                                       Color(v[4], v[5], v[6])));
+        ++nbPrimitives;
+    } else if (matches(word, length, "camera")) {
+        Real v[10];
+        if (!parseReals(s, v, 10)) return error("camera: position target up fov expected");
+        camera.position = Point3(v[0], v[1], v[2]);
+        camera.target = Point3(v[3], v[4], v[5]);
+        camera.up = Vector3(v[6], v[7], v[8]);
+        camera.fov = v[9];
+        hasCamera = true;
+    } else if (matches(word, length, "keyframe")) {
+        Real v[11];
+        if (!parseReals(s, v, 11)) return error("keyframe: time position target up fov expected");
+        Camera key;
+        key.position = Point3(v[1], v[2], v[3]);
+        key.target = Point3(v[4], v[5], v[6]);
+        key.up = Vector3(v[7], v[8], v[9]);
+        key.fov = v[10];
+        path.addKeyFrame(v[0], key);
+    } else if (matches(word, length, "background")) {
+        const char *kind;
+        std::size_t kind_length = token(s, kind);
+        Background *bg;
+        if (matches(kind, kind_length, "basic")) bg = new BasicBackground;
+        else if (matches(kind, kind_length, "none")) bg = 0;
+        else if (matches(kind, kind_length, "sky")) {
+            const char *name;
+            std::size_t name_length = token(s, name);
+            if (name_length == 0) return error("background: sky file name expected");
+            std::string filename(name, name_length);
+            if (filename[0] != '/') filename = myDirectory + filename;
+            files.push_back(filename);
+            std::ifstream input(filename.c_str(), std::ios::binary);
+            Image2D<Color> photo;
+            if (!input.good() || !Image2DReader<Color>::read(photo, input))
+                return error("background: invalid sky image");
+            bg = new FisheyeSky(photo);
+        } else return error("background: basic, sky or none expected");
+        delete background;
+        background = bg;
+        hasBackground = true;
+    } else
+        return error("unknown item");
+    if (!isEnd(s)) return error("unexpected characters at end of line");
+    return true;
+}
+
+void
+rt::SceneReader::addMaterial(const char *name, std::size_t length, const Material &m) {
+    NamedMaterial nm;
+    std::memcpy(nm.name, name, length);
+    nm.name[length] = '\0';
+    nm.material = m;
+    nm.index = -1;
+    // A redefinition hides the previous material of the same name.
+    myMaterials.push_back(nm);
+    myLastMaterial = -1;
+}
+
+rt::TriangleMesh *
+rt::SceneReader::readMesh(const char *&s) {
+    const char *name;
+    std::size_t name_length = token(s, name);
+    if (name_length == 0) {
+        error("mesh: file name expected");
+        return 0;
+    }
+    std::string filename(name, name_length);
+    if (filename[0] != '/') filename = myDirectory + filename;
+    int m = findMaterial(s);
+    if (m < 0) {
+        error("mesh: unknown material");
+        return 0;
+    }
+    files.push_back(filename);
+    TriangleMesh *mesh = new TriangleMesh(myMaterials[m].material);
+    ObjReader obj_reader;
+    if (!obj_reader.read(*mesh, filename)) {
+        delete mesh;
+        error("mesh: invalid OBJ file");
+        return 0;
+    }
+    nbPrimitives += obj_reader.nbTriangles;
+    myMeshBytes += obj_reader.nbBytes;
+    indexTime += obj_reader.indexTime;
+    return mesh;
+}
+
+int
+rt::SceneReader::findMaterial(const char *&s) {
+    const char *name;
+    std::size_t length = token(s, name);
+    if (length == 0 || length >= NAME_SIZE) return -1;
+    if (myLastMaterial >= 0 && matches(name, length, myMaterials[myLastMaterial].name))
+        return myLastMaterial;
+    for (int m = (int) myMaterials.size() - 1; m >= 0; --m)
+        if (matches(name, length, myMaterials[m].name)) return myLastMaterial = m;
+    return -1;
+}
+
+bool
+rt::SceneReader::error(const char *message) const {
+    std::cerr << "SceneReader: line " << myLine << ": " << message << std::endl;
+    return false;
+}
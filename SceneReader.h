@@ -0,0 +1,145 @@
+/**
+@file SceneReader.h
+*/
+#pragma once
+#ifndef _SCENE_READER_H_
+#define _SCENE_READER_H_
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Scene.h"
+#include "Camera.h"
+#include "CameraPath.h"
+#include "Background.h"
+#include "SphereSet.h"
+#include "TriangleMesh.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /**
+  Reads a scene description file and builds the corresponding
+  objects, lights, camera and background. The format is a text file
+  with one item per line, '#' starting comments:
+
+  \code
+  # name ambient(rgb) diffuse(rgb) specular(rgb) shinyness
+  #      coef_diffusion coef_reflexion coef_refraction in_index out_index
+  material red  0.1 0 0  0.85 0.05 0.05  1 0.8 0.8  5  1 0.05 0  1 1
+  # material name predefined_material
+  material myglass glass
+  sphere  x y z radius material
+  bubble  x y z radius material
+  # triangle mesh read from a Wavefront OBJ file (relative to the scene file)
+  mesh    file.obj material
+  # named mesh, only displayed through its instances
+  object  name file.obj material
+  # copy of an object scaled, rotated of angle degrees around axis, then translated by t
+  instance name  tx ty tz  [scale [ax ay az angle]]
+  # point light (w=0 for a light at infinity)
+  light   x y z w  r g b
+  # area lights casting soft shadows: parallelogram of sides u and v, sphere
+  rectlight   cx cy cz  ux uy uz  vx vy vz  r g b
+  spherelight x y z radius  r g b
+  camera  px py pz  tx ty tz  ux uy uz  fov
+  # camera at time t of the path of a film (see CameraPath)
+  keyframe t  px py pz  tx ty tz  ux uy uz  fov
+  # sky of a fish-eye photo (PPM, relative to the scene file), see FisheyeSky
+  background basic|none|sky file.ppm
+  \endcode
+
+  The predefined materials (whitePlastic, redPlastic, bronze, emerald,
+  glass) can be used without being declared. Spheres and bubbles (thin
+  shells) are stored contiguously in one SphereSet added to the scene, and every
+  mesh is a TriangleMesh. The instances of an object share it (see
+  Instance).
+
+  The file is read by blocks into a fixed buffer and parsed in place,
+  without allocating anything per line or per token, so that files
+  with millions of spheres are read at disk speed.
+  */
+  struct SceneReader {
+    /// Thickness of the shell of bubbles.
+    static constexpr Real BUBBLE_THICKNESS = 0.02f;
+
+    /// The camera of the file (valid if hasCamera).
+    Camera camera;
+    /// 'true' when the file specifies a camera.
+    bool hasCamera;
+    /// The path of the camera given by the keyframes of the file.
+    CameraPath path;
+    /// The background of the file (valid if hasBackground, 0 means
+    /// black). The caller is responsible for its deallocation.
+    Background* background;
+    /// 'true' when the file specifies a background.
+    bool hasBackground;
+    /// The spheres of the file, added to the scene (0 if there are none).
+    SphereSet* spheres;
+    /// The files referenced by the file (meshes, sky), read by the last
+    /// call to read.
+    std::vector<std::string> files;
+
+    /// Number of bytes read by the last call to read (meshes included).
+    std::size_t nbBytes;
+    /// Number of primitives (spheres, triangles, lights) read by the last call to read.
+    std::size_t nbPrimitives;
+    /// Time spent to parse the file (in seconds).
+    double parseTime;
+    /// Time spent to build the indices of the spheres and meshes (in seconds).
+    double indexTime;
+
+    /// Default constructor.
+    SceneReader();
+
+    /// Reads the scene file \a filename and adds its content to \a scene.
+    /// @return 'true' if everything went well, otherwise an error is
+    /// displayed on std::cerr.
+    bool read( Scene& scene, const std::string& filename );
+
+    /// Reads a scene from \a input and adds its content to \a scene.
+    /// @return 'true' if everything went well, otherwise an error is
+    /// displayed on std::cerr.
+    bool read( Scene& scene, std::istream& input );
+
+    /// Displays the statistics of the last read (throughput).
+    void displayStatistics( std::ostream& output ) const;
+
+  private:
+    /// Maximal length of a material name.
+    static const std::size_t NAME_SIZE = 32;
+
+    /// A material declared in the file (or predefined).
+    struct NamedMaterial {
+      char name[ NAME_SIZE ];
+      Material material;
+      /// index in the material table of mySpheres (-1 if not yet used).
+      int index;
+    };
+
+    std::vector<NamedMaterial> myMaterials;
+    /// Material used by the last sphere (consecutive spheres often share it).
+    int myLastMaterial;
+    SphereSet* mySpheres;
+    int myNbLights;
+    std::size_t myLine;
+    /// The objects declared in the file, that may be instanced.
+    std::vector< std::pair< std::string, std::shared_ptr<GraphicalObject> > > myObjects;
+    /// directory of the scene file (meshes are relative to it).
+    std::string myDirectory;
+    /// bytes read from mesh files.
+    std::size_t myMeshBytes;
+
+    bool parseLine( Scene& scene, const char* s );
+    void addMaterial( const char* name, std::size_t length, const Material& m );
+    /// @return the index of the material named by the next token (-1 if unknown).
+    int findMaterial( const char*& s );
+    /// Reads "file.obj material" and the mesh it designates (0 if invalid).
+    TriangleMesh* readMesh( const char*& s );
+    bool error( const char* message ) const;
+  };
+
+} // namespace rt
+
+#endif // #define _SCENE_READER_H_
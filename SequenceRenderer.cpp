@@ -0,0 +1,200 @@
+/**
+@file SequenceRenderer.cpp
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "SequenceRenderer.h"
+
+rt::Real
+rt::SequenceRenderer::frameTime(const CameraPath &path, int frame, int nb_frames) {
+    if (nb_frames <= 1) return path.firstTime();
+    Real s = (Real) frame / (Real) (nb_frames - 1);
+    return (1.0f - s) * path.firstTime() + s * path.lastTime();
+}
+
+void
+rt::SequenceRenderer::wait() {
+    if (!myWriter.joinable()) return;
+    auto t0 = std::chrono::steady_clock::now();
+    myWriter.join();
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+    myWaitTime += t.count();
+}
+
+rt::Real
+rt::SequenceRenderer::reproject(const Camera &camera, int frame) {
+    int w = myRenderer.myWidth, h = myRenderer.myHeight;
+    std::size_t n = (std::size_t) w * h;
+    bool has_previous = frame > 0 && myPreviousSamples.size() == n;
+    mySamples.resize(n);
+    mySources.assign(n, -1);
+    ScreenProjection previous(myPreviousCamera, w, h), current(camera, w, h);
+    Real cos_max = cos(myMaxViewAngle * M_PI / 180.0);
+    Real cos_normal = cos(MAX_NORMAL_ANGLE * M_PI / 180.0);
+    long candidates = 0, rejected = 0;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            int i = y * w + x;
+            Ray ray = myRenderer.eyeRay(x, y, 1);
+            GraphicalObject *obj;
+            RayHit hit;
+            bool found = myRenderer.ptrScene->rayIntersection(ray, obj, hit) < 0.0f;
+            Sample &sample = mySamples[i];
+            sample.point = hit.point;
+            sample.normal = hit.normal;
+            sample.object = found ? obj : 0;
+            sample.view = hit.point - camera.position;
+            Real distance = sample.view.norm();
+            if (distance > 0.0f) sample.view /= distance;
+            sample.age = 0;
+            sample.reusable = found && hit.material.coef_reflexion <= myMaxReflexion
+                              && hit.material.coef_refraction == 0.0f;
+            sample.specular = hit.material.specular.max() > 0.0f;
+            // Some pixels are traced in turn, whatever their point.
+            if (!sample.reusable || !has_previous || (x * 5 + y * 3 + frame) % myRefreshPeriod == 0)
+                continue;
+            ++candidates;
+            Real px, py;
+            int xs = -1, ys = -1;
+            if (previous.project(hit.point, px, py)) {
+                xs = (int) floor(px + 0.5f);
+                ys = (int) floor(py + 0.5f);
+            }
+            if (xs < 0 || xs >= w || ys < 0 || ys >= h) {
+                ++rejected;
+                continue;
+            }
+            // The point of the previous pixel must be the same: on the same
+            // surface, not hidden then, and seen less than MAX_SHIFT pixel
+            // away from this one (a shadow edge or a silhouette may be in
+            // between otherwise). The view only matters to specular points.
+            const Sample &old = myPreviousSamples[ys * w + xs];
+            Real ox, oy;
+            if (old.reusable && old.age + 1 < myRefreshPeriod && old.object == sample.object
+                && old.normal.dot(sample.normal) >= cos_normal
+                && current.project(old.point, ox, oy)
+                && std::fabs(ox - x) <= MAX_SHIFT && std::fabs(oy - y) <= MAX_SHIFT
+                && (!sample.specular || old.view.dot(sample.view) >= cos_max))
+                mySources[i] = ys * w + xs;
+            else
+                ++rejected;
+        }
+    return candidates > 0 ? (Real) rejected / (Real) candidates : 1.0f;
+}
+
+rt::SequenceRenderer::ScreenProjection::ScreenProjection(const Camera &camera, int width, int height)
+        : position(camera.position), width(width), height(height) {
+    // Same frame as Camera::getViewBox, in which Renderer::eyeRay
+    // interpolates the directions of the pixels.
+    f = camera.target - camera.position;
+    f /= f.norm();
+    s = f.cross(camera.up);
+    s /= s.norm();
+    u = s.cross(f);
+    b = tan(camera.fov * M_PI / 360.0);
+    a = b * (Real) width / (Real) height;
+}
+
+bool
+rt::SequenceRenderer::ScreenProjection::project(const Point3 &p, Real &x, Real &y) const {
+    Vector3 d = p - position;
+    Real z = d.dot(f);
+    if (z <= 0.0f) return false;
+    x = (d.dot(s) / z + a) / (2.0f * a) * (width - 1);
+    y = (b - d.dot(u) / z) / (2.0f * b) * (height - 1);
+    return true;
+}
+
+rt::Real
+rt::SequenceRenderer::contrast(const Color &c1, const Color &c2) {
+    return std::max(std::max(std::fabs(c1.r() - c2.r()), std::fabs(c1.g() - c2.g())),
+                    std::fabs(c1.b() - c2.b()));
+}
+
+long
+rt::SequenceRenderer::reuse(const Image2D<Color> &previous, Image2D<Color> &image) {
+    int w = myRenderer.myWidth, h = myRenderer.myHeight;
+    if (image.w() != w || image.h() != h) image = Image2D<Color>(w, h);
+    if (myMask.w() != w || myMask.h() != h) myMask = Image2D<unsigned char>(w, h);
+    long traced = 0;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            int i = y * w + x, j = mySources[i];
+            myMask.at(x, y) = j < 0;
+            if (j < 0) {
+                ++traced;
+                continue;
+            }
+            // A point next to a shadow edge (or any sharp change of color)
+            // may be on the other side of it, even less than a pixel away.
+            int xs = j % w, ys = j / w;
+            Color c = previous.at(xs, ys);
+            if ((xs > 0 && contrast(c, previous.at(xs - 1, ys)) > MAX_CONTRAST)
+                || (xs + 1 < w && contrast(c, previous.at(xs + 1, ys)) > MAX_CONTRAST)
+                || (ys > 0 && contrast(c, previous.at(xs, ys - 1)) > MAX_CONTRAST)
+                || (ys + 1 < h && contrast(c, previous.at(xs, ys + 1)) > MAX_CONTRAST)) {
+                myMask.at(x, y) = 1;
+                ++traced;
+                continue;
+            }
+            image.at(x, y) = c;
+            mySamples[i] = myPreviousSamples[j];
+            ++mySamples[i].age;
+        }
+    return traced;
+}
+
+bool
+rt::SequenceRenderer::render(const CameraPath &path, int nb_frames, int width, int height,
+                             int max_depth, FrameSink &sink) {
+    auto t0 = std::chrono::steady_clock::now();
+    myWritten = true;
+    myWaitTime = 0.0;
+    myNbReprojected = myNbTraced = 0;
+    myPreviousSamples.clear();
+    myRenderer.setResolution(width, height);
+    for (int k = 0; k < nb_frames; ++k) {
+        std::cout << "Frame " << k + 1 << "/" << nb_frames << std::endl;
+        Camera camera = path.at(frameTime(path, k, nb_frames));
+        Vector3 dirUL, dirUR, dirLL, dirLR;
+        camera.getViewBox(width, height, dirUL, dirUR, dirLL, dirLR);
+        myRenderer.setViewBox(camera.position, dirUL, dirUR, dirLL, dirLR);
+        // The image written two frames ago is free once the previous
+        // writer is done, which is checked before starting the next one.
+        Image2D<Color> &image = myImages[k % 2];
+        long traced = (long) width * height;
+        if (myReproject) {
+            myRenderer.ptrScene->update();
+            Real rejected = reproject(camera, k);
+            // The previous frame may be read while it is written.
+            if (rejected <= myMaxRejected) {
+                traced = reuse(myImages[(k + 1) % 2], image);
+                myRenderer.setMask(&myMask);
+            } else if (k > 0)
+                std::cout << "Frame traced again: " << (int) (100 * rejected)
+                          << "% of the points of the previous frame could not be reprojected." << std::endl;
+        }
+        myRenderer.render(image, max_depth);
+        myRenderer.setMask(0);
+        myNbTraced += traced;
+        myNbReprojected += (long) width * height - traced;
+        myPreviousCamera = camera;
+        mySamples.swap(myPreviousSamples);
+        wait();
+        if (!myWritten) break;
+        myWriter = std::thread([this, &sink, &image, k]() {
+            if (!sink.writeFrame(k, image)) myWritten = false;
+        });
+    }
+    wait();
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+    std::cout << nb_frames << " frames in " << t.count() << " s ("
+              << t.count() / std::max(nb_frames, 1) << " s per frame, " << myWaitTime
+              << " s waiting for the writes)." << std::endl;
+    if (myReproject)
+        std::cout << (100 * myNbReprojected) / std::max(myNbReprojected + myNbTraced, 1L)
+                  << "% of the pixels reprojected." << std::endl;
+    return myWritten;
+}
@@ -0,0 +1,170 @@
+/**
+@file SequenceRenderer.h
+*/
+#pragma once
+#ifndef _SEQUENCE_RENDERER_H_
+#define _SEQUENCE_RENDERER_H_
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "CameraPath.h"
+#include "FrameSink.h"
+#include "Renderer.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Renders the frames of a film, seen from the cameras of a path at
+  /// regular times. The same renderer and scene are used for all frames,
+  /// so that what does not change between frames (index of the objects,
+  /// light tree, environment map) is not computed again (see
+  /// Renderer::beginRender).
+  ///
+  /// Frames are rendered into two images in turn: while a frame is
+  /// traced, the previous one is written by a thread into the sink, so
+  /// that the renderer does not wait for the disk.
+  ///
+  /// When only the camera moves, most of the points seen in a frame were
+  /// seen in the previous one. With reprojection (setReprojection), the
+  /// eye rays of a frame are only intersected with the scene, and the
+  /// pixels whose point was already shaded in the previous frame get its
+  /// color. The other pixels are traced (see Renderer::setMask):
+  /// - points hidden or out of the previous frame, and the background,
+  /// - points of mirrors and transparent points, whose color depends on
+  ///   the view,
+  /// - points whose previous pixel saw another point (more than half a
+  ///   pixel away, or on another object or with another normal), or a
+  ///   color next to a sharp edge, such as a shadow boundary,
+  /// - specular points seen under an angle that changed too much since
+  ///   they were shaded (highlights move), or points shaded too many
+  ///   frames ago,
+  /// - a fraction of the pixels (1/refresh period), in turn.
+  /// When too many points that could be reprojected are not (the
+  /// reprojection is not reliable, e.g. the camera moves too fast), the
+  /// frame is traced again entirely.
+  struct SequenceRenderer {
+
+    /// Constructor. \a renderer is already set up (scene, background,
+    /// samples), the view is the one of each frame.
+    SequenceRenderer( Renderer& renderer ) : myRenderer( renderer ) {}
+    /// Waits for the frame being written.
+    ~SequenceRenderer() { wait(); }
+
+    /// Renders \a nb_frames frames of size \a width x \a height along
+    /// \a path into \a sink.
+    /// @return 'true' if all frames were written.
+    bool render( const CameraPath& path, int nb_frames, int width, int height,
+                 int max_depth, FrameSink& sink );
+
+    /// Enables or disables the reprojection of the previous frame.
+    void setReprojection( bool reproject ) { myReproject = reproject; }
+    /// Sets the number of frames after which a reprojected point is
+    /// shaded again; 1 / \a period of the pixels are traced at each frame.
+    void setRefreshPeriod( int period ) { myRefreshPeriod = std::max( period, 1 ); }
+    /// Sets the largest angle in degrees between the view of a point when
+    /// it was shaded and its current view for it to be reprojected.
+    void setMaxViewAngle( Real degrees ) { myMaxViewAngle = degrees; }
+    /// Sets the largest coefficient of reflexion of the points which are
+    /// reprojected (points reflecting more are mirrors).
+    void setMaxReflexion( Real coef ) { myMaxReflexion = coef; }
+    /// Sets the fraction of the points that could be reprojected but are
+    /// not beyond which the whole frame is traced again.
+    void setMaxRejected( Real fraction ) { myMaxRejected = fraction; }
+
+    /// @return the time along \a path of the frame \a frame among \a
+    /// nb_frames (the first and last frames are the ends of the path).
+    static Real frameTime( const CameraPath& path, int frame, int nb_frames );
+
+  private:
+    /// The largest distance between the center of a pixel and the point
+    /// reprojected into it, seen from the current camera (in pixels).
+    static constexpr Real MAX_SHIFT = 0.5f;
+    /// The largest angle in degrees between the normals of a point and of
+    /// the one reprojected into its pixel.
+    static constexpr Real MAX_NORMAL_ANGLE = 10.0f;
+    /// The largest difference of a channel between the color of a reused
+    /// pixel and the ones of its neighbours.
+    static constexpr Real MAX_CONTRAST = 0.05f;
+
+    /// Projects points into the image of a camera, as seen by the eye
+    /// rays of Renderer.
+    struct ScreenProjection {
+      Point3 position;
+      Vector3 f, s, u;
+      Real a, b;
+      int width, height;
+
+      ScreenProjection( const Camera& camera, int width, int height );
+      /// Gives the coordinates (\a x, \a y) in pixels of \a p.
+      /// @return 'false' if it is behind the camera.
+      bool project( const Point3& p, Real& x, Real& y ) const;
+    };
+
+    /// The point seen through a pixel, whose color is the one of the pixel.
+    struct Sample {
+      /// the point, shaded when seen in the direction view
+      Point3 point;
+      Vector3 view;
+      /// the normal and the object at the point
+      Vector3 normal;
+      const GraphicalObject* object;
+      /// number of frames since it was shaded
+      int age;
+      /// 'false' for the background and for points whose color depends on
+      /// the view.
+      bool reusable;
+      /// 'true' when its material has a specular term, whose highlights
+      /// move with the view.
+      bool specular;
+    };
+
+    Renderer& myRenderer;
+    bool myReproject = false;
+    int myRefreshPeriod = 8;
+    Real myMaxViewAngle = 5.0f;
+    Real myMaxReflexion = 0.25f;
+    Real myMaxRejected = 0.5f;
+    /// The points of the pixels of the frame being rendered and of the
+    /// previous one, seen from myPreviousCamera.
+    std::vector<Sample> mySamples, myPreviousSamples;
+    Camera myPreviousCamera;
+    /// The pixel of the previous frame reprojected into each pixel, or -1.
+    std::vector<int> mySources;
+    /// The pixels to trace.
+    Image2D<unsigned char> myMask;
+    /// Number of pixels reprojected and traced.
+    long myNbReprojected = 0, myNbTraced = 0;
+    /// The frame being rendered and the one being written, in turn.
+    Image2D<Color> myImages[ 2 ];
+    /// Writes the previous frame.
+    std::thread myWriter;
+    /// 'false' once a frame could not be written.
+    bool myWritten = true;
+    /// Time spent waiting for the writer.
+    double myWaitTime = 0.0;
+
+    /// Waits for the frame being written.
+    void wait();
+    /// Intersects the eye rays of \a camera (already given to the
+    /// renderer) with the scene, filling mySamples with their points as
+    /// if they were all traced, and mySources with the pixels of the
+    /// previous frame (number \a frame - 1) whose point can be reused
+    /// (-1 for none).
+    /// @return the fraction of the points which could be reprojected
+    /// (neither refreshed, nor mirrors, nor background) but are not (1
+    /// when there is no previous frame).
+    Real reproject( const Camera& camera, int frame );
+    /// @return the largest difference of a channel between \a c1 and \a c2.
+    static Real contrast( const Color& c1, const Color& c2 );
+    /// Copies the colors of the pixels of mySources from \a previous into
+    /// \a image, with their samples, and fills myMask with the other
+    /// pixels, and with the ones whose source has a neighbour of a too
+    /// different color (MAX_CONTRAST).
+    /// @return the number of pixels to trace.
+    long reuse( const Image2D<Color>& previous, Image2D<Color>& image );
+  };
+
+} // namespace rt
+
+#endif // #define _SEQUENCE_RENDERER_H_
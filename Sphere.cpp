@@ -119,4 +119,10 @@ rt::Sphere::rayIntersection(const Ray &ray, Point3 &p) {
         p = center - center_closest_point;
     }
     return sphere_distance;
-}
\ No newline at end of file
+}
+
+rt::BoundingBox
+rt::Sphere::getBoundingBox() {
+    Vector3 r(radius, radius, radius);
+    return BoundingBox(center - r, center + r);
+}
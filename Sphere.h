@@ -31,6 +31,7 @@ namespace rt {
 
     // ---------------- GraphicalObject services ----------------------------
   public:
+    using GraphicalObject::rayIntersection;
 
     /// This method is called by Scene::init() at the beginning of the
     /// display in the OpenGL window. May be useful for some
@@ -46,6 +47,9 @@ namespace rt {
     /// should be on or close to the sphere).
     Vector3 getNormal( Point3 p );
 
+    /// @return 'true' if the material is opaque.
+    bool isOpaque() { return material.isOpaque(); }
+
     /// @return the material associated to this part of the object
     Material getMaterial( Point3 p );
 
@@ -57,6 +61,9 @@ namespace rt {
     /// kind of distance to the closest point of intersection.
     Real rayIntersection( const Ray& ray, Point3& p );
 
+    /// @return the box [center-radius,center+radius].
+    BoundingBox getBoundingBox();
+
   public:
     /// The center of the sphere
     Point3 center;
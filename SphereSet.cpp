@@ -0,0 +1,196 @@
+/**
+@file SphereSet.cpp
+*/
+#include <cmath>
+#include <limits>
+#include "SphereSet.h"
+#include "Sphere.h"
+
+namespace {
+    /// Used by BVH::closest to keep the closest sphere hit.
+    struct ClosestSphere {
+        const rt::Ray &ray;
+        const rt::SphereSet::Element *elements;
+        int best;
+        bool inner;
+
+        ClosestSphere(const rt::Ray &aRay, const rt::SphereSet::Element *someElements)
+                : ray(aRay), elements(someElements), best(-1), inner(false) {}
+
+        void operator()(unsigned int i, rt::Real &tmax) {
+            const rt::SphereSet::Element &e = elements[i];
+            bool hit = e.thickness > 0.0f
+                       ? rt::intersectShell(ray, e.center, e.radius, e.thickness, tmax, tmax, inner)
+                       : rt::intersectSphere(ray, e.center, e.radius, tmax, tmax);
+            if (hit) {
+                best = (int) i;
+                if (e.thickness <= 0.0f) inner = false;
+            }
+        }
+    };
+}
+
+void
+rt::SphereSet::buildIndex() {
+    myElements = elements.data();
+    myNbElements = elements.size();
+    myMaterials = materials.data();
+    myNbMaterials = materials.size();
+    std::vector<unsigned int> items(elements.size());
+    std::vector<BoundingBox> boxes(elements.size());
+    std::vector<int> leaves;
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        Vector3 r(elements[i].radius, elements[i].radius, elements[i].radius);
+        items[i] = (unsigned int) i;
+        boxes[i] = BoundingBox(elements[i].center - r, elements[i].center + r);
+    }
+    myIndex.build(items, boxes, leaves);
+}
+
+void
+rt::SphereSet::map(const Element *someElements, std::size_t nb_elements,
+                   const Material *someMaterials, std::size_t nb_materials,
+                   const BVH<unsigned int>::Node *nodes, int nb_nodes, int root) {
+    elements.clear();
+    materials.clear();
+    myElements = someElements;
+    myNbElements = nb_elements;
+    myMaterials = someMaterials;
+    myNbMaterials = nb_materials;
+    myIndex.map(nodes, nb_nodes, root, (int) nb_elements);
+}
+
+void
+rt::SphereSet::draw(Viewer &viewer) {
+    if (myNbElements <= MAX_DRAWN_SPHERES) {
+        for (std::size_t i = 0; i < myNbElements; ++i) {
+            const Element &e = myElements[i];
+            Sphere(e.center, e.radius, myMaterials[e.material]).draw(viewer);
+        }
+        return;
+    }
+    // Too many spheres, only their centers are displayed.
+    glBegin(GL_POINTS);
+    for (std::size_t i = 0; i < myNbElements; ++i) {
+        const Element &e = myElements[i];
+        glColor4fv(myMaterials[e.material].diffuse);
+        glVertex3fv(e.center);
+    }
+    glEnd();
+}
+
+rt::Vector3
+rt::SphereSet::getNormal(Point3 p) {
+    bool inner;
+    const Element &e = myElements[locate(p, inner)];
+    Vector3 u = p - e.center;
+    Real l2 = u.dot(u);
+    if (l2 != 0.0) u /= sqrt(l2);
+    return u;
+}
+
+rt::Material
+rt::SphereSet::getMaterial(Point3 p) {
+    bool inner;
+    const Element &e = myElements[locate(p, inner)];
+    return surfaceMaterial(e, inner);
+}
+
+rt::Real
+rt::SphereSet::rayIntersection(const Ray &ray, Point3 &p) {
+    Real t;
+    bool inner;
+    if (closest(ray, t, inner) < 0) return 1.0f;
+    p = ray.origin + t * ray.direction;
+    return -t;
+}
+
+rt::Real
+rt::SphereSet::rayIntersection(const Ray &ray, RayHit &hit) {
+    Real t;
+    bool inner;
+    int i = closest(ray, t, inner);
+    if (i < 0) return 1.0f;
+    const Element &e = myElements[i];
+    hit.point = ray.origin + t * ray.direction;
+    hit.normal = (hit.point - e.center) / (inner ? e.radius - e.thickness : e.radius);
+    hit.material = surfaceMaterial(e, inner);
+    hit.primitive = (unsigned int) i;
+    return -t;
+}
+
+rt::Real
+rt::SphereSet::primitiveIntersection(const Ray &ray, unsigned int primitive, RayHit &hit) {
+    if (primitive >= myNbElements) return 1.0f;
+    ClosestSphere test(ray, myElements);
+    Real t = std::numeric_limits<Real>::infinity();
+    test(primitive, t);
+    if (test.best < 0) return 1.0f;
+    const Element &e = myElements[primitive];
+    hit.point = ray.origin + t * ray.direction;
+    hit.normal = (hit.point - e.center) / (test.inner ? e.radius - e.thickness : e.radius);
+    hit.material = surfaceMaterial(e, test.inner);
+    hit.primitive = primitive;
+    return -t;
+}
+
+bool
+rt::SphereSet::isOpaque() {
+    for (std::size_t i = 0; i < myNbMaterials; ++i)
+        if (!myMaterials[i].isOpaque()) return false;
+    return true;
+}
+
+rt::BoundingBox
+rt::SphereSet::getBoundingBox() {
+    if (myIndex.root() == BVH<unsigned int>::NONE) return BoundingBox();
+    return myIndex.node(myIndex.root()).box;
+}
+
+int
+rt::SphereSet::closest(const Ray &ray, Real &t, bool &inner) const {
+    ClosestSphere test(ray, myElements);
+    t = std::numeric_limits<Real>::infinity();
+    myIndex.closest(ray, t, test);
+    inner = test.inner;
+    return test.best;
+}
+
+unsigned int
+rt::SphereSet::locate(const Point3 &p, bool &inner) const {
+    typedef BVH<unsigned int> Index;
+    unsigned int best = 0;
+    inner = false;
+    Real best_d = std::numeric_limits<Real>::infinity();
+    if (myIndex.root() == Index::NONE) return best;
+    // Visits the subtrees whose box contain p (or are close enough to it).
+    std::vector<int> stack(1, myIndex.root());
+    while (!stack.empty()) {
+        const Index::Node &n = myIndex.node(stack.back());
+        stack.pop_back();
+        bool inside = true;
+        for (int k = 0; k < 3 && inside; ++k)
+            inside = p[k] >= n.box.lo[k] - best_d && p[k] <= n.box.hi[k] + best_d;
+        if (!inside) continue;
+        if (n.isLeaf()) {
+            const Element &e = myElements[n.item];
+            Real l = rt::distance(p, e.center);
+            Real d = std::fabs(l - e.radius);
+            if (d < best_d) {
+                best_d = d;
+                best = n.item;
+                inner = false;
+            }
+            d = std::fabs(l - (e.radius - e.thickness));
+            if (e.thickness > 0.0f && d < best_d) {
+                best_d = d;
+                best = n.item;
+                inner = true;
+            }
+        } else {
+            stack.push_back(n.left);
+            stack.push_back(n.right);
+        }
+    }
+    return best;
+}
@@ -0,0 +1,237 @@
+/**
+@file SphereSet.h
+*/
+#pragma once
+#ifndef _SPHERE_SET_H_
+#define _SPHERE_SET_H_
+
+#include <algorithm>
+#include <vector>
+#include "GraphicalObject.h"
+#include "BVH.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A set of spheres stored contiguously, with a table of materials
+  /// shared by the spheres and its own bounding volume hierarchy. It
+  /// is a single GraphicalObject for the scene, which is much cheaper
+  /// than one Sphere object per sphere when there are millions of them.
+  ///
+  /// A sphere may also be a thick shell (e.g. a soap bubble), whose
+  /// outer and inner surfaces are intersected in a single test. The
+  /// inner surface has the material of the shell with swapped
+  /// refractive indices, since rays cross it from the inside of the
+  /// shell.
+  ///
+  /// Spheres and materials are either the ones added to the set, or
+  /// arrays stored elsewhere (typically a memory-mapped compiled scene,
+  /// see CompiledSceneReader) given to map(), which are used in place.
+  struct SphereSet : public GraphicalObject {
+
+    /// Above this number of spheres, draw() only displays their centers.
+    static const std::size_t MAX_DRAWN_SPHERES = 10000;
+
+    /// A sphere of the set.
+    struct Element {
+      /// The center of the sphere
+      Point3 center;
+      /// The radius of the sphere
+      Real radius;
+      /// The thickness of the shell (0 for a solid sphere).
+      Real thickness;
+      /// The index of its material in the table of materials.
+      unsigned int material;
+    };
+
+    /// Virtual destructor since object contains virtual methods.
+    virtual ~SphereSet() {}
+
+    /// Creates an empty set.
+    SphereSet()
+      : GraphicalObject(), myElements( 0 ), myNbElements( 0 ),
+        myMaterials( 0 ), myNbMaterials( 0 )
+    {}
+
+    /// Adds a material to the table of materials.
+    /// @return its index.
+    unsigned int addMaterial( const Material& m )
+    {
+      materials.push_back( m );
+      return (unsigned int) materials.size() - 1;
+    }
+
+    /// Adds a sphere of center \a c and radius \a r, whose material has
+    /// index \a m in the table of materials.
+    void addSphere( const Point3& c, Real r, unsigned int m )
+    {
+      Element e;
+      e.center   = c;
+      e.radius    = r;
+      e.thickness = 0.0f;
+      e.material  = m;
+      elements.push_back( e );
+    }
+
+    /// Adds a shell of center \a c, outer radius \a r and thickness \a
+    /// thickness (< r), whose material has index \a m in the table of
+    /// materials.
+    void addShell( const Point3& c, Real r, Real thickness, unsigned int m )
+    {
+      addSphere( c, r, m );
+      elements.back().thickness = thickness;
+    }
+
+    /// Must be called once the spheres are added or changed, before any
+    /// ray intersection.
+    void buildIndex();
+
+    /// Uses the given spheres, materials and hierarchy (as given by
+    /// element(), material() and index() of another set) without copying
+    /// them. They must outlive the set. Added spheres are forgotten.
+    void map( const Element* someElements, std::size_t nb_elements,
+              const Material* someMaterials, std::size_t nb_materials,
+              const BVH<unsigned int>::Node* nodes, int nb_nodes, int root );
+
+    /// @return the number of spheres (once indexed or mapped).
+    std::size_t nbElements() const { return myNbElements; }
+    /// @return the \a i-th sphere.
+    const Element& element( std::size_t i ) const { return myElements[ i ]; }
+    /// @return the number of materials (once indexed or mapped).
+    std::size_t nbMaterials() const { return myNbMaterials; }
+    /// @return the \a i-th material.
+    const Material& material( std::size_t i ) const { return myMaterials[ i ]; }
+    /// @return the hierarchy over the spheres.
+    const BVH<unsigned int>& index() const { return myIndex; }
+
+    // ---------------- GraphicalObject services ----------------------------
+  public:
+    using GraphicalObject::rayIntersection;
+
+    /// This method is called by Scene::init() at the beginning of the
+    /// display in the OpenGL window.
+    void init( Viewer& /* viewer */ ) {}
+
+    /// This method is called by Scene::draw() at each frame to
+    /// redisplay objects in the OpenGL window.
+    void draw( Viewer& viewer );
+
+    /// @return the normal vector at point \a p on the set (\a p should
+    /// be on or close to one of the spheres).
+    Vector3 getNormal( Point3 p );
+
+    /// @return the material of the sphere closest to \a p.
+    Material getMaterial( Point3 p );
+
+    /// @param[in] ray the incoming ray
+    /// @param[out] returns the point of intersection with the closest
+    /// sphere (if any).
+    ///
+    /// @return either a real < 0.0 if there is an intersection, or a
+    /// positive real otherwise.
+    Real rayIntersection( const Ray& ray, Point3& p );
+
+    /// Same as above, and also gives the normal and material of the
+    /// sphere hit, whose index is returned in hit.primitive.
+    Real rayIntersection( const Ray& ray, RayHit& hit );
+
+    /// Same as above, for the sphere \a primitive only.
+    Real primitiveIntersection( const Ray& ray, unsigned int primitive, RayHit& hit );
+
+    /// @return 'true' if all materials are opaque.
+    bool isOpaque();
+
+    /// @return the box containing all spheres.
+    BoundingBox getBoundingBox();
+
+  public:
+    /// The spheres added to the set.
+    std::vector<Element> elements;
+    /// The table of materials added to the set.
+    std::vector<Material> materials;
+
+  protected:
+    /// The spheres used for rendering (elements, or mapped ones).
+    const Element* myElements;
+    std::size_t myNbElements;
+    /// The materials used for rendering (materials, or mapped ones).
+    const Material* myMaterials;
+    std::size_t myNbMaterials;
+    /// The hierarchy over the spheres.
+    BVH<unsigned int> myIndex;
+
+    /// @return the index of the sphere whose surface is closest to \a
+    /// p, \a inner telling if it is the inner surface of a shell.
+    unsigned int locate( const Point3& p, bool& inner ) const;
+    /// @return the index of the closest sphere hit by the ray, or -1,
+    /// its distance in \a t, and \a inner telling if the inner surface
+    /// of a shell is hit.
+    int closest( const Ray& ray, Real& t, bool& inner ) const;
+    /// @return the material of the surface of \a e (swapped indices for
+    /// the inner surface of a shell).
+    Material surfaceMaterial( const Element& e, bool inner ) const
+    {
+      Material m = myMaterials[ e.material ];
+      if ( inner ) std::swap( m.in_refractive_index, m.out_refractive_index );
+      return m;
+    }
+  };
+
+  /// Intersects the ray with the sphere (c,r).
+  /// @return 'true' if it is hit at distance \a t in ]0,tmax[. When the
+  /// origin is inside the sphere, this is the exit point.
+  inline bool intersectSphere( const Ray& ray, const Point3& c, Real r,
+                               Real tmax, Real& t )
+  {
+    Vector3 oc = ray.origin - c;
+    Real b = oc.dot( ray.direction );
+    Real d = b * b - ( oc.dot( oc ) - r * r );
+    if ( d < 0.0f ) return false;
+    d = sqrt( d );
+    Real t0 = -b - d;
+    Real t1 = -b + d;
+    Real tt = t0 >= 0.0f ? t0 : t1;
+    if ( tt < 0.0f || tt >= tmax ) return false;
+    t = tt;
+    return true;
+  }
+
+  /// Intersects the ray with the shell of center \a c between the radii
+  /// \a r and \a r - \a thickness. Both spheres share the terms of
+  /// their equations, so that the four roots come from one test.
+  /// @return 'true' if it is hit at distance \a t in ]0,tmax[, \a inner
+  /// telling if it is the inner surface.
+  inline bool intersectShell( const Ray& ray, const Point3& c, Real r, Real thickness,
+                              Real tmax, Real& t, bool& inner )
+  {
+    Vector3 oc = ray.origin - c;
+    Real b = oc.dot( ray.direction );
+    Real d = b * b - ( oc.dot( oc ) - r * r );
+    if ( d < 0.0f ) return false;
+    Real ri = r - thickness;
+    // The inner sphere is only hit when the ray is close enough to c.
+    Real di = d - ( r * r - ri * ri );
+    d = sqrt( d );
+    Real roots[ 4 ] = { -b - d, 0.0f, 0.0f, -b + d };
+    int nb = 2;
+    if ( di >= 0.0f ) {
+      di = sqrt( di );
+      roots[ 1 ] = -b - di;
+      roots[ 2 ] = -b + di;
+      nb = 4;
+    }
+    // Roots are sorted: the first nonnegative one is hit.
+    for ( int k = 0; k < 4; ++k ) {
+      if ( nb == 2 && ( k == 1 || k == 2 ) ) continue;
+      if ( roots[ k ] < 0.0f ) continue;
+      if ( roots[ k ] >= tmax ) return false;
+      t = roots[ k ];
+      inner = k == 1 || k == 2;
+      return true;
+    }
+    return false;
+  }
+
+} // namespace rt
+
+#endif // #define _SPHERE_SET_H_
@@ -0,0 +1,166 @@
+/**
+@file TextParser.h
+*/
+#pragma once
+#ifndef _TEXT_PARSER_H_
+#define _TEXT_PARSER_H_
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "PointVector.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Small helpers to parse big text files (scenes, meshes) quickly:
+  /// lines are read by blocks and parsed in place, without allocating
+  /// anything per line or per token, and numbers are read without
+  /// locales (much faster than strtod or streams).
+  namespace TextParser {
+
+    /// Size of the buffer of readLines(), i.e. maximal length of a line.
+    static const std::size_t BUFFER_SIZE = 1 << 20;
+
+    inline bool isSpace( char c ) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline void skipSpaces( const char*& s ) { while ( isSpace( *s ) ) ++s; }
+
+    /// @return 'true' if there is nothing left on the line but a comment.
+    inline bool isEnd( const char* s )
+    {
+      skipSpaces( s );
+      return *s == '\0' || *s == '#';
+    }
+
+    /// Reads the next token (up to a space), returns its length (0 at
+    /// end of line).
+    inline std::size_t token( const char*& s, const char*& begin )
+    {
+      skipSpaces( s );
+      begin = s;
+      while ( *s != '\0' && ! isSpace( *s ) ) ++s;
+      return s - begin;
+    }
+
+    /// @return 'true' if the token [begin,begin+length[ is \a word.
+    inline bool matches( const char* begin, std::size_t length, const char* word )
+    {
+      return std::strlen( word ) == length && std::strncmp( begin, word, length ) == 0;
+    }
+
+    /// Reads an integer (with optional sign), stops at the first other
+    /// character.
+    inline bool parseInt( const char*& s, long& value )
+    {
+      bool negative = *s == '-';
+      if ( *s == '-' || *s == '+' ) ++s;
+      if ( ! ( *s >= '0' && *s <= '9' ) ) return false;
+      long v = 0;
+      for ( ; *s >= '0' && *s <= '9'; ++s ) v = 10 * v + ( *s - '0' );
+      value = negative ? -v : v;
+      return true;
+    }
+
+    /// Reads a decimal number (with optional sign, fraction and
+    /// exponent), which must be followed by a space or the end of line.
+    inline bool parseReal( const char*& s, Real& value )
+    {
+      static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                       1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+      skipSpaces( s );
+      bool negative = *s == '-';
+      if ( *s == '-' || *s == '+' ) ++s;
+      unsigned long long mantissa = 0;
+      int exponent = 0;
+      int digits = 0;
+      for ( ; *s >= '0' && *s <= '9'; ++s, ++digits ) {
+        if ( mantissa < 100000000000000000ULL ) mantissa = 10 * mantissa + ( *s - '0' );
+        else ++exponent;
+      }
+      if ( *s == '.' ) {
+        for ( ++s; *s >= '0' && *s <= '9'; ++s, ++digits )
+          if ( mantissa < 100000000000000000ULL ) {
+            mantissa = 10 * mantissa + ( *s - '0' );
+            --exponent;
+          }
+      }
+      if ( digits == 0 ) return false;
+      if ( *s == 'e' || *s == 'E' ) {
+        ++s;
+        bool negative_exp = *s == '-';
+        if ( *s == '-' || *s == '+' ) ++s;
+        if ( ! ( *s >= '0' && *s <= '9' ) ) return false;
+        int e = 0;
+        for ( ; *s >= '0' && *s <= '9'; ++s ) e = std::min( 10 * e + ( *s - '0' ), 1000 );
+        exponent += negative_exp ? -e : e;
+      }
+      if ( *s != '\0' && ! isSpace( *s ) ) return false;
+      double v = (double) mantissa;
+      while ( exponent > 0 ) {
+        int k = std::min( exponent, 18 );
+        v *= powers[ k ];
+        exponent -= k;
+      }
+      while ( exponent < 0 ) {
+        int k = std::min( -exponent, 18 );
+        v /= powers[ k ];
+        exponent += k;
+      }
+      value = (Real) ( negative ? -v : v );
+      return true;
+    }
+
+    /// Reads \a n numbers.
+    inline bool parseReals( const char*& s, Real* values, int n )
+    {
+      for ( int i = 0; i < n; ++i )
+        if ( ! parseReal( s, values[ i ] ) ) return false;
+      return true;
+    }
+
+    /// Reads \a input by blocks and calls \a parse_line( line ) on every
+    /// line (without its end of line, 0-terminated) until it returns
+    /// 'false'. \a nb_bytes receives the number of bytes read.
+    /// @return 'true' if every line was parsed.
+    template <typename LineParser>
+    bool readLines( std::istream& input, std::size_t& nb_bytes, LineParser& parse_line )
+    {
+      // The part of a line cut at the end of a block is moved at the
+      // beginning of the buffer.
+      std::vector<char> buffer( BUFFER_SIZE + 1 );
+      std::size_t kept = 0;
+      nb_bytes = 0;
+      while ( true ) {
+        input.read( buffer.data() + kept, BUFFER_SIZE - kept );
+        std::size_t n = (std::size_t) input.gcount();
+        bool eof = n == 0;
+        nb_bytes += n;
+        n += kept;
+        char* line = buffer.data();
+        char* end  = line + n;
+        char* nl;
+        while ( ( nl = (char*) std::memchr( line, '\n', end - line ) ) != 0 ) {
+          *nl = '\0';
+          if ( ! parse_line( (const char*) line ) ) return false;
+          line = nl + 1;
+        }
+        kept = end - line;
+        if ( eof ) {
+          *end = '\0';
+          return kept == 0 || parse_line( (const char*) line );
+        }
+        if ( kept == BUFFER_SIZE ) {
+          std::cerr << "TextParser: line too long" << std::endl;
+          return false;
+        }
+        std::memmove( buffer.data(), line, kept );
+      }
+    }
+
+  } // namespace TextParser
+
+} // namespace rt
+
+#endif // #define _TEXT_PARSER_H_
@@ -0,0 +1,51 @@
+/**
+@file TileSink.h
+*/
+#pragma once
+#ifndef _TILE_SINK_H_
+#define _TILE_SINK_H_
+
+#include "Color.h"
+#include "Image2D.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// Receives the tiles of an image as they are rendered (see
+  /// WavefrontRenderer::render). Each tile comes once, but in any order:
+  /// WavefrontRenderer gives them row of tiles by row of tiles, from top
+  /// to bottom and from left to right, whereas DistributedRenderer gives
+  /// them as the workers finish them.
+  struct TileSink {
+    virtual ~TileSink() {}
+
+    /// Receives the pixels [x0,x1[ x [y0,y1[, given row by row in \a
+    /// pixels, with colors already clamped. When \a rendered is not 0,
+    /// it tells in the same order which pixels were rendered (not 0),
+    /// the other ones must be left as they are (see Renderer::setMask).
+    virtual void writeTile( int x0, int y0, int x1, int y1, const Color* pixels,
+                            const unsigned char* rendered ) = 0;
+  };
+
+  /// A sink storing the tiles into an image in memory. Colors are
+  /// converted to the pixels of the image (e.g. RGB8, see PixelFormat.h)
+  /// as tiles are written.
+  template <typename TValue, typename TLayout = RowMajorLayout>
+  struct ImageTileSink : public TileSink {
+    Image2D<TValue, TLayout>& image;
+
+    ImageTileSink( Image2D<TValue, TLayout>& img ) : image( img ) {}
+
+    void writeTile( int x0, int y0, int x1, int y1, const Color* pixels,
+                    const unsigned char* rendered )
+    {
+      for ( int y = y0; y < y1; ++y )
+        for ( int x = x0; x < x1; ++x, ++pixels )
+          if ( rendered == 0 || *rendered++ != 0 )
+            image.at( x, y ) = TValue( *pixels );
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _TILE_SINK_H_
@@ -0,0 +1,151 @@
+/**
+@file Transform.h
+*/
+#pragma once
+#ifndef _TRANSFORM_H_
+#define _TRANSFORM_H_
+
+#include <cmath>
+#include "PointVector.h"
+#include "BoundingBox.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// An affine transformation of the space, stored as a 3x4 matrix
+  /// (linear part and translation). Points are transformed by the
+  /// whole matrix, vectors by its linear part, and normals by the
+  /// transpose of the linear part of the inverse.
+  struct Transform {
+    /// m[ i ][ j ] is the coefficient at row i and column j.
+    Real m[ 3 ][ 4 ];
+
+    /// Default constructor. The identity.
+    Transform()
+    {
+      for ( int i = 0; i < 3; ++i )
+        for ( int j = 0; j < 4; ++j )
+          m[ i ][ j ] = i == j ? 1.0f : 0.0f;
+    }
+
+    /// @return the translation of vector \a t.
+    static Transform translation( const Vector3& t )
+    {
+      Transform T;
+      for ( int i = 0; i < 3; ++i ) T.m[ i ][ 3 ] = t[ i ];
+      return T;
+    }
+
+    /// @return the scaling of factors \a s (along each axis).
+    static Transform scaling( const Vector3& s )
+    {
+      Transform T;
+      for ( int i = 0; i < 3; ++i ) T.m[ i ][ i ] = s[ i ];
+      return T;
+    }
+
+    /// @return the rotation of \a angle degrees around \a axis.
+    static Transform rotation( Vector3 axis, Real angle )
+    {
+      Transform T;
+      Real l = axis.norm();
+      if ( l == 0.0f ) return T;
+      axis /= l;
+      Real a = angle * M_PI / 180.0;
+      Real c = cos( a ), s = sin( a ), t = 1.0f - c;
+      Real x = axis[ 0 ], y = axis[ 1 ], z = axis[ 2 ];
+      T.m[ 0 ][ 0 ] = t*x*x + c;   T.m[ 0 ][ 1 ] = t*x*y - s*z; T.m[ 0 ][ 2 ] = t*x*z + s*y;
+      T.m[ 1 ][ 0 ] = t*x*y + s*z; T.m[ 1 ][ 1 ] = t*y*y + c;   T.m[ 1 ][ 2 ] = t*y*z - s*x;
+      T.m[ 2 ][ 0 ] = t*x*z - s*y; T.m[ 2 ][ 1 ] = t*y*z + s*x; T.m[ 2 ][ 2 ] = t*z*z + c;
+      return T;
+    }
+
+    /// @return the composition (*this) o \a other, i.e. \a other is
+    /// applied first.
+    Transform operator*( const Transform& other ) const
+    {
+      Transform T;
+      for ( int i = 0; i < 3; ++i )
+        for ( int j = 0; j < 4; ++j ) {
+          Real v = j == 3 ? m[ i ][ 3 ] : 0.0f;
+          for ( int k = 0; k < 3; ++k ) v += m[ i ][ k ] * other.m[ k ][ j ];
+          T.m[ i ][ j ] = v;
+        }
+      return T;
+    }
+
+    /// @return the inverse transformation (the identity if the
+    /// transformation is singular).
+    Transform inverse() const
+    {
+      Transform T;
+      Real c[ 3 ][ 3 ];
+      for ( int i = 0; i < 3; ++i )
+        for ( int j = 0; j < 3; ++j ) {
+          // cofactor of m[ j ][ i ], i.e. coefficient of the adjugate.
+          int j1 = ( j + 1 ) % 3, j2 = ( j + 2 ) % 3;
+          int i1 = ( i + 1 ) % 3, i2 = ( i + 2 ) % 3;
+          c[ i ][ j ] = m[ j1 ][ i1 ] * m[ j2 ][ i2 ] - m[ j1 ][ i2 ] * m[ j2 ][ i1 ];
+        }
+      Real det = m[ 0 ][ 0 ] * c[ 0 ][ 0 ] + m[ 0 ][ 1 ] * c[ 1 ][ 0 ] + m[ 0 ][ 2 ] * c[ 2 ][ 0 ];
+      if ( det == 0.0f ) return T;
+      for ( int i = 0; i < 3; ++i ) {
+        for ( int j = 0; j < 3; ++j ) T.m[ i ][ j ] = c[ i ][ j ] / det;
+        T.m[ i ][ 3 ] = 0.0f;
+        for ( int k = 0; k < 3; ++k ) T.m[ i ][ 3 ] -= T.m[ i ][ k ] * m[ k ][ 3 ];
+      }
+      return T;
+    }
+
+    /// @return the image of the point \a p.
+    Point3 point( const Point3& p ) const
+    {
+      return Point3( m[ 0 ][ 0 ] * p[ 0 ] + m[ 0 ][ 1 ] * p[ 1 ] + m[ 0 ][ 2 ] * p[ 2 ] + m[ 0 ][ 3 ],
+                     m[ 1 ][ 0 ] * p[ 0 ] + m[ 1 ][ 1 ] * p[ 1 ] + m[ 1 ][ 2 ] * p[ 2 ] + m[ 1 ][ 3 ],
+                     m[ 2 ][ 0 ] * p[ 0 ] + m[ 2 ][ 1 ] * p[ 1 ] + m[ 2 ][ 2 ] * p[ 2 ] + m[ 2 ][ 3 ] );
+    }
+
+    /// @return the image of the vector \a v (linear part only).
+    Vector3 vector( const Vector3& v ) const
+    {
+      return Vector3( m[ 0 ][ 0 ] * v[ 0 ] + m[ 0 ][ 1 ] * v[ 1 ] + m[ 0 ][ 2 ] * v[ 2 ],
+                      m[ 1 ][ 0 ] * v[ 0 ] + m[ 1 ][ 1 ] * v[ 1 ] + m[ 1 ][ 2 ] * v[ 2 ],
+                      m[ 2 ][ 0 ] * v[ 0 ] + m[ 2 ][ 1 ] * v[ 1 ] + m[ 2 ][ 2 ] * v[ 2 ] );
+    }
+
+    /// @return the image of \a v by the transpose of the linear part.
+    /// Normals are transformed by the transpose of the inverse, i.e.
+    /// T.inverse().transposedVector( n ).
+    Vector3 transposedVector( const Vector3& v ) const
+    {
+      return Vector3( m[ 0 ][ 0 ] * v[ 0 ] + m[ 1 ][ 0 ] * v[ 1 ] + m[ 2 ][ 0 ] * v[ 2 ],
+                      m[ 0 ][ 1 ] * v[ 0 ] + m[ 1 ][ 1 ] * v[ 1 ] + m[ 2 ][ 1 ] * v[ 2 ],
+                      m[ 0 ][ 2 ] * v[ 0 ] + m[ 1 ][ 2 ] * v[ 1 ] + m[ 2 ][ 2 ] * v[ 2 ] );
+    }
+
+    /// @return a box containing the image of the box \a b.
+    BoundingBox box( const BoundingBox& b ) const
+    {
+      if ( b.isEmpty() || ! b.isBounded() ) return b.isEmpty() ? b : BoundingBox::infinite();
+      BoundingBox result;
+      for ( int corner = 0; corner < 8; ++corner )
+        result.extend( point( Point3( corner & 1 ? b.hi[ 0 ] : b.lo[ 0 ],
+                                      corner & 2 ? b.hi[ 1 ] : b.lo[ 1 ],
+                                      corner & 4 ? b.hi[ 2 ] : b.lo[ 2 ] ) ) );
+      return result;
+    }
+
+    /// Gives the transformation as an OpenGL matrix (column-major 4x4),
+    /// e.g. for glMultMatrixf.
+    void getGLMatrix( float gl[ 16 ] ) const
+    {
+      for ( int j = 0; j < 4; ++j ) {
+        for ( int i = 0; i < 3; ++i ) gl[ 4 * j + i ] = m[ i ][ j ];
+        gl[ 4 * j + 3 ] = j == 3 ? 1.0f : 0.0f;
+      }
+    }
+  };
+
+} // namespace rt
+
+#endif // #define _TRANSFORM_H_
@@ -0,0 +1,192 @@
+/**
+@file TriangleMesh.cpp
+*/
+#include <cmath>
+#include <limits>
+#include "TriangleMesh.h"
+
+namespace {
+    /// Used by BVH::closest to keep the closest triangle hit.
+    struct ClosestTriangle {
+        rt::TriangleRay ray;
+        const rt::TriangleMesh &mesh;
+        int best;
+        rt::Real u, v;
+
+        ClosestTriangle(const rt::Ray &aRay, const rt::TriangleMesh &aMesh)
+                : ray(aRay), mesh(aMesh), best(-1), u(0.0f), v(0.0f) {}
+
+        void operator()(unsigned int i, rt::Real &tmax) {
+            const unsigned int *f = mesh.faces[i].vertices;
+            rt::Real fu, fv;
+            if (rt::intersectTriangle(ray, mesh.vertices[f[0]], mesh.vertices[f[1]], mesh.vertices[f[2]],
+                                      tmax, tmax, fu, fv)) {
+                best = (int) i;
+                u = fu;
+                v = fv;
+            }
+        }
+    };
+}
+
+void
+rt::TriangleMesh::buildIndex() {
+    std::vector<unsigned int> items(faces.size());
+    std::vector<BoundingBox> boxes(faces.size());
+    std::vector<int> leaves;
+    for (std::size_t i = 0; i < faces.size(); ++i) {
+        const unsigned int *f = faces[i].vertices;
+        items[i] = (unsigned int) i;
+        boxes[i] = BoundingBox(vertices[f[0]], vertices[f[0]]);
+        boxes[i].extend(vertices[f[1]]).extend(vertices[f[2]]);
+    }
+    myIndex.build(items, boxes, leaves);
+}
+
+rt::Vector3
+rt::TriangleMesh::normal(unsigned int i, Real u, Real v) const {
+    const Face &f = faces[i];
+    Vector3 n;
+    if (f.normals[0] != NO_NORMAL)
+        n = u * normals[f.normals[0]] + v * normals[f.normals[1]]
+            + (1.0f - u - v) * normals[f.normals[2]];
+    else {
+        const Point3 &a = vertices[f.vertices[0]];
+        n = (vertices[f.vertices[1]] - a).cross(vertices[f.vertices[2]] - a);
+    }
+    Real l = n.norm();
+    if (l != 0.0f) n /= l;
+    return n;
+}
+
+void
+rt::TriangleMesh::draw(Viewer & /* viewer */) {
+    glColor4fv(material.ambient);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, material.diffuse);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, material.specular);
+    glMaterialf(GL_FRONT, GL_SHININESS, material.shinyness);
+    if (faces.size() > MAX_DRAWN_TRIANGLES) {
+        // Too many triangles, only their vertices are displayed.
+        glBegin(GL_POINTS);
+        for (const Point3 &p : vertices) glVertex3fv(p);
+        glEnd();
+        return;
+    }
+    glBegin(GL_TRIANGLES);
+    for (std::size_t i = 0; i < faces.size(); ++i) {
+        const Face &f = faces[i];
+        Vector3 flat = normal((unsigned int) i, 1.0f / 3.0f, 1.0f / 3.0f);
+        for (int k = 0; k < 3; ++k) {
+            glNormal3fv(f.normals[k] != NO_NORMAL ? normals[f.normals[k]] : flat);
+            glVertex3fv(vertices[f.vertices[k]]);
+        }
+    }
+    glEnd();
+}
+
+rt::Vector3
+rt::TriangleMesh::getNormal(Point3 p) {
+    const Face &f = faces[locate(p)];
+    const Point3 &a = vertices[f.vertices[0]];
+    Vector3 n = (vertices[f.vertices[1]] - a).cross(vertices[f.vertices[2]] - a);
+    Real l = n.norm();
+    if (l != 0.0f) n /= l;
+    return n;
+}
+
+rt::Material
+rt::TriangleMesh::getMaterial(Point3 /* p */) {
+    return material;
+}
+
+rt::Real
+rt::TriangleMesh::rayIntersection(const Ray &ray, Point3 &p) {
+    Real t, u, v;
+    if (closest(ray, t, u, v) < 0) return 1.0f;
+    p = ray.origin + t * ray.direction;
+    return -t;
+}
+
+rt::Real
+rt::TriangleMesh::rayIntersection(const Ray &ray, RayHit &hit) {
+    Real t, u, v;
+    int i = closest(ray, t, u, v);
+    if (i < 0) return 1.0f;
+    hit.point = ray.origin + t * ray.direction;
+    hit.normal = normal((unsigned int) i, u, v);
+    hit.material = material;
+    hit.primitive = (unsigned int) i;
+    return -t;
+}
+
+rt::Real
+rt::TriangleMesh::primitiveIntersection(const Ray &ray, unsigned int primitive, RayHit &hit) {
+    if (primitive >= faces.size()) return 1.0f;
+    ClosestTriangle test(ray, *this);
+    Real t = std::numeric_limits<Real>::infinity();
+    test(primitive, t);
+    if (test.best < 0) return 1.0f;
+    hit.point = ray.origin + t * ray.direction;
+    hit.normal = normal(primitive, test.u, test.v);
+    hit.material = material;
+    hit.primitive = primitive;
+    return -t;
+}
+
+rt::BoundingBox
+rt::TriangleMesh::getBoundingBox() {
+    if (myIndex.root() == BVH<unsigned int>::NONE) return BoundingBox();
+    return myIndex.node(myIndex.root()).box;
+}
+
+int
+rt::TriangleMesh::closest(const Ray &ray, Real &t, Real &u, Real &v) const {
+    ClosestTriangle test(ray, *this);
+    t = std::numeric_limits<Real>::infinity();
+    myIndex.closest(ray, t, test);
+    u = test.u;
+    v = test.v;
+    return test.best;
+}
+
+unsigned int
+rt::TriangleMesh::locate(const Point3 &p) const {
+    typedef BVH<unsigned int> Index;
+    unsigned int best = 0;
+    Real best_d = std::numeric_limits<Real>::infinity();
+    if (myIndex.root() == Index::NONE) return best;
+    // Visits the subtrees whose box contain p (or are close enough to
+    // it), and keeps the triangle whose plane is the closest to p among
+    // those containing its projection.
+    std::vector<int> stack(1, myIndex.root());
+    while (!stack.empty()) {
+        const Index::Node &n = myIndex.node(stack.back());
+        stack.pop_back();
+        bool inside = true;
+        for (int k = 0; k < 3 && inside; ++k)
+            inside = p[k] >= n.box.lo[k] - best_d && p[k] <= n.box.hi[k] + best_d;
+        if (!inside) continue;
+        if (!n.isLeaf()) {
+            stack.push_back(n.left);
+            stack.push_back(n.right);
+            continue;
+        }
+        const unsigned int *f = faces[n.item].vertices;
+        const Point3 &a = vertices[f[0]];
+        Vector3 ab = vertices[f[1]] - a, ac = vertices[f[2]] - a, ap = p - a;
+        Vector3 normal = ab.cross(ac);
+        Real area2 = normal.dot(normal);
+        if (area2 == 0.0f) continue;
+        // Barycentric coordinates of the projection of p.
+        Real v = ap.cross(ac).dot(normal) / area2;
+        Real w = ab.cross(ap).dot(normal) / area2;
+        const Real eps = 1e-4f;
+        if (v < -eps || w < -eps || v + w > 1.0f + eps) continue;
+        Real d = std::fabs(ap.dot(normal)) / std::sqrt(area2);
+        if (d < best_d) {
+            best_d = d;
+            best = n.item;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,210 @@
+/**
+@file TriangleMesh.h
+*/
+#pragma once
+#ifndef _TRIANGLE_MESH_H_
+#define _TRIANGLE_MESH_H_
+
+#include <cmath>
+#include <vector>
+#include "GraphicalObject.h"
+#include "BVH.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A ray prepared for intersecting many triangles with
+  /// intersectTriangle(): the axes are permuted so that the ray goes
+  /// along z, and the shear that makes it parallel to z is precomputed.
+  struct TriangleRay {
+    /// origin of the ray
+    Point3 origin;
+    /// kz is the axis where the direction is largest, kx, ky the others.
+    int kx, ky, kz;
+    /// shear constants
+    Real sx, sy, sz;
+
+    TriangleRay( const Ray& ray )
+      : origin( ray.origin )
+    {
+      const Vector3& d = ray.direction;
+      Real ax = std::fabs( d[ 0 ] ), ay = std::fabs( d[ 1 ] ), az = std::fabs( d[ 2 ] );
+      kz = ( ax >= ay && ax >= az ) ? 0 : ( ay >= az ? 1 : 2 );
+      kx = ( kz + 1 ) % 3;
+      ky = ( kx + 1 ) % 3;
+      // Keeps the winding of triangles.
+      if ( d[ kz ] < 0.0f ) std::swap( kx, ky );
+      sx = d[ kx ] / d[ kz ];
+      sy = d[ ky ] / d[ kz ];
+      sz = 1.0f / d[ kz ];
+    }
+  };
+
+  /// Watertight ray/triangle intersection (Woop, Benthin, Wald 2013):
+  /// rays never pass between two triangles sharing an edge, nor hit
+  /// both. The triangle is expressed in the sheared frame of the ray,
+  /// where the test reduces to the signs of three 2D edge functions,
+  /// with straight-line code only (the double precision fallback is
+  /// only taken for rays exactly on an edge).
+  /// @return 'true' if the triangle (a,b,c) is hit at distance \a t in
+  /// ]0,tmax[, at the point u*a + v*b + (1-u-v)*c.
+  inline bool intersectTriangle( const TriangleRay& r,
+                                 const Point3& a, const Point3& b, const Point3& c,
+                                 Real tmax, Real& t, Real& u, Real& v )
+  {
+    Vector3 A = a - r.origin;
+    Vector3 B = b - r.origin;
+    Vector3 C = c - r.origin;
+    Real ax = A[ r.kx ] - r.sx * A[ r.kz ], ay = A[ r.ky ] - r.sy * A[ r.kz ];
+    Real bx = B[ r.kx ] - r.sx * B[ r.kz ], by = B[ r.ky ] - r.sy * B[ r.kz ];
+    Real cx = C[ r.kx ] - r.sx * C[ r.kz ], cy = C[ r.ky ] - r.sy * C[ r.kz ];
+    Real eu = cx * by - cy * bx;
+    Real ev = ax * cy - ay * cx;
+    Real ew = bx * ay - by * ax;
+    if ( eu == 0.0f || ev == 0.0f || ew == 0.0f ) {
+      eu = (Real) ( (double) cx * (double) by - (double) cy * (double) bx );
+      ev = (Real) ( (double) ax * (double) cy - (double) ay * (double) cx );
+      ew = (Real) ( (double) bx * (double) ay - (double) by * (double) ax );
+    }
+    if ( ( eu < 0.0f || ev < 0.0f || ew < 0.0f ) && ( eu > 0.0f || ev > 0.0f || ew > 0.0f ) )
+      return false;
+    Real det = eu + ev + ew;
+    if ( det == 0.0f ) return false;
+    Real tt = eu * r.sz * A[ r.kz ] + ev * r.sz * B[ r.kz ] + ew * r.sz * C[ r.kz ];
+    // Compares tt / det with ]0,tmax[ without dividing.
+    if ( det < 0.0f ? ( tt >= 0.0f || tt <= tmax * det ) : ( tt <= 0.0f || tt >= tmax * det ) )
+      return false;
+    Real inv_det = 1.0f / det;
+    t = tt * inv_det;
+    u = eu * inv_det;
+    v = ev * inv_det;
+    return true;
+  }
+
+  /// A triangulated surface with one material. Vertices and normals are
+  /// stored once in shared buffers and triangles refer to them by
+  /// index, so that a mesh with millions of triangles is a single
+  /// GraphicalObject for the scene, with its own bounding volume
+  /// hierarchy over its triangles.
+  struct TriangleMesh : public GraphicalObject {
+
+    /// Above this number of triangles, draw() only displays vertices.
+    static const std::size_t MAX_DRAWN_TRIANGLES = 200000;
+    /// Normal index of a triangle without normals (it is flat).
+    static const unsigned int NO_NORMAL = 0xffffffff;
+
+    /// A triangle of the mesh (counterclockwise when seen from outside).
+    struct Face {
+      /// indices of its vertices
+      unsigned int vertices[ 3 ];
+      /// indices of the normals at its vertices (NO_NORMAL for a flat triangle)
+      unsigned int normals[ 3 ];
+    };
+
+    /// Virtual destructor since object contains virtual methods.
+    virtual ~TriangleMesh() {}
+
+    /// Creates an empty mesh made of material \a m.
+    TriangleMesh( const Material& m = Material::whitePlastic() )
+      : GraphicalObject(), material( m )
+    {}
+
+    /// Adds a vertex. @return its index.
+    unsigned int addVertex( const Point3& p )
+    {
+      vertices.push_back( p );
+      return (unsigned int) vertices.size() - 1;
+    }
+
+    /// Adds a normal (normalized). @return its index.
+    unsigned int addNormal( const Vector3& n )
+    {
+      Real l = n.norm();
+      normals.push_back( l != 0.0f ? n / l : n );
+      return (unsigned int) normals.size() - 1;
+    }
+
+    /// Adds the triangle of vertices \a a, \a b, \a c (and normals \a
+    /// na, \a nb, \a nc if the surface is smooth).
+    void addTriangle( unsigned int a, unsigned int b, unsigned int c,
+                      unsigned int na = NO_NORMAL, unsigned int nb = NO_NORMAL,
+                      unsigned int nc = NO_NORMAL )
+    {
+      Face f;
+      f.vertices[ 0 ] = a;  f.vertices[ 1 ] = b;  f.vertices[ 2 ] = c;
+      f.normals[ 0 ]  = na; f.normals[ 1 ]  = nb; f.normals[ 2 ]  = nc;
+      faces.push_back( f );
+    }
+
+    /// Must be called once the triangles are added or changed, before
+    /// any ray intersection.
+    void buildIndex();
+
+    /// @return the normal of the triangle \a i at the point u*a + v*b +
+    /// (1-u-v)*c (interpolated if it has normals).
+    Vector3 normal( unsigned int i, Real u, Real v ) const;
+
+    // ---------------- GraphicalObject services ----------------------------
+  public:
+    using GraphicalObject::rayIntersection;
+
+    /// This method is called by Scene::init() at the beginning of the
+    /// display in the OpenGL window.
+    void init( Viewer& /* viewer */ ) {}
+
+    /// This method is called by Scene::draw() at each frame to
+    /// redisplay objects in the OpenGL window.
+    void draw( Viewer& viewer );
+
+    /// @return the normal vector at point \a p on the mesh (\a p should
+    /// be on one of the triangles).
+    Vector3 getNormal( Point3 p );
+
+    /// @return the material of the mesh.
+    Material getMaterial( Point3 p );
+
+    /// @param[in] ray the incoming ray
+    /// @param[out] returns the point of intersection with the closest
+    /// triangle (if any).
+    ///
+    /// @return either a real < 0.0 if there is an intersection, or a
+    /// positive real otherwise.
+    Real rayIntersection( const Ray& ray, Point3& p );
+
+    /// Same as above, and also gives the normal and material of the
+    /// triangle hit, whose index is returned in hit.primitive.
+    Real rayIntersection( const Ray& ray, RayHit& hit );
+
+    /// Same as above, for the triangle \a primitive only.
+    Real primitiveIntersection( const Ray& ray, unsigned int primitive, RayHit& hit );
+
+    /// @return 'true' if the material is opaque.
+    bool isOpaque() { return material.isOpaque(); }
+
+    /// @return the box containing all triangles.
+    BoundingBox getBoundingBox();
+
+  public:
+    /// The vertices.
+    std::vector<Point3> vertices;
+    /// The normals at vertices.
+    std::vector<Vector3> normals;
+    /// The triangles.
+    std::vector<Face> faces;
+    /// The material (global to the mesh).
+    Material material;
+
+  protected:
+    /// The hierarchy over the triangles.
+    BVH<unsigned int> myIndex;
+
+    /// @return the index of the triangle containing \a p.
+    unsigned int locate( const Point3& p ) const;
+    /// @return the index of the closest triangle hit by the ray, or -1,
+    /// with its distance \a t and the coordinates \a u, \a v of the hit.
+    int closest( const Ray& ray, Real& t, Real& u, Real& v ) const;
+  };
+
+} // namespace rt
+
+#endif // #define _TRIANGLE_MESH_H_
@@ -0,0 +1,107 @@
+/**
+@file VideoFrameSink.cpp
+*/
+#include <algorithm>
+#include <iostream>
+#include "VideoFrameSink.h"
+
+// Rows of colors are read as arrays of floats.
+static_assert(sizeof(rt::Color) == 3 * sizeof(float), "colors must be 3 floats");
+
+namespace {
+    /// @return 'true' if \a image has the size \a width x \a height,
+    /// which is set by the first frame.
+    bool checkSize(const char *sink, const rt::Image2D<rt::Color> &image, int &width, int &height) {
+        if (width == 0) {
+            width = image.w();
+            height = image.h();
+        }
+        if (image.w() == width && image.h() == height && width > 0 && height > 0) return true;
+        std::cerr << "[" << sink << "::writeFrame] Frame of size " << image.w() << "x" << image.h()
+                  << " instead of " << width << "x" << height << "." << std::endl;
+        return false;
+    }
+}
+
+void
+rt::Y4MFrameSink::toYCbCr(const float *rgb, std::size_t n, float *y, float *cb, float *cr) {
+    // Values stay floats: the chroma is averaged on blocks before being
+    // rounded, and rounding the luma in writeFrame keeps this loop simple.
+    for (std::size_t i = 0; i < n; ++i) {
+        float r = rgb[3 * i], g = rgb[3 * i + 1], b = rgb[3 * i + 2];
+        float l = 0.299f * r + 0.587f * g + 0.114f * b;
+        y[i] = 16.0f + 219.0f * l;
+        cb[i] = 128.0f + (112.0f / 0.886f) * (b - l);
+        cr[i] = 128.0f + (112.0f / 0.701f) * (r - l);
+    }
+}
+
+bool
+rt::Y4MFrameSink::writeFrame(int frame, Image2D<Color> &image) {
+    bool first = myWidth == 0;
+    if (!checkSize("Y4MFrameSink", image, myWidth, myHeight)) return false;
+    int w = myWidth, h = myHeight;
+    // Chroma planes have the size of the image divided by 2, rounded up.
+    int cw = mySubsample ? (w + 1) / 2 : w;
+    int ch = mySubsample ? (h + 1) / 2 : h;
+    if (first)
+        myOutput << "YUV4MPEG2 W" << w << " H" << h << " F" << myFPS << ":1 Ip A1:1 "
+                 << (mySubsample ? "C420jpeg" : "C444") << "\n";
+    myY.resize(2 * (std::size_t) w);
+    myCb.resize(2 * (std::size_t) w);
+    myCr.resize(2 * (std::size_t) w);
+    myPlanes.resize((std::size_t) w * h + 2 * (std::size_t) cw * ch);
+    unsigned char *Y = myPlanes.data();
+    unsigned char *Cb = Y + (std::size_t) w * h;
+    unsigned char *Cr = Cb + (std::size_t) cw * ch;
+    int step = mySubsample ? 2 : 1;
+    for (int y = 0; y < h; y += step) {
+        // The rows y and y + 1 (the last one is repeated for odd heights).
+        int rows = std::min(step, h - y);
+        for (int k = 0; k < rows; ++k) {
+            toYCbCr((const float *) image.at(0, y + k), w, &myY[k * w], &myCb[k * w], &myCr[k * w]);
+            unsigned char *luma = Y + (std::size_t) (y + k) * w;
+            for (int x = 0; x < w; ++x) luma[x] = (unsigned char) (myY[k * w + x] + 0.5f);
+        }
+        unsigned char *cb = Cb + (std::size_t) (y / step) * cw;
+        unsigned char *cr = Cr + (std::size_t) (y / step) * cw;
+        if (!mySubsample) {
+            for (int x = 0; x < w; ++x) {
+                cb[x] = (unsigned char) (myCb[x] + 0.5f);
+                cr[x] = (unsigned char) (myCr[x] + 0.5f);
+            }
+            continue;
+        }
+        const float *cb1 = &myCb[(rows - 1) * w], *cr1 = &myCr[(rows - 1) * w];
+        for (int x = 0; x < cw; ++x) {
+            int x0 = 2 * x, x1 = std::min(2 * x + 1, w - 1);
+            cb[x] = (unsigned char) (0.25f * (myCb[x0] + myCb[x1] + cb1[x0] + cb1[x1]) + 0.5f);
+            cr[x] = (unsigned char) (0.25f * (myCr[x0] + myCr[x1] + cr1[x0] + cr1[x1]) + 0.5f);
+        }
+    }
+    myOutput << "FRAME\n";
+    myOutput.write((const char *) myPlanes.data(), (std::streamsize) myPlanes.size());
+    myOutput.flush();
+    if (!myOutput.good()) {
+        std::cerr << "[Y4MFrameSink::writeFrame] Unable to write frame " << frame << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool
+rt::RawFrameSink::writeFrame(int frame, Image2D<Color> &image) {
+    if (!checkSize("RawFrameSink", image, myWidth, myHeight)) return false;
+    std::size_t n = (std::size_t) myWidth * myHeight * 3;
+    myBytes.resize(n);
+    // Same conversion as Image2DWriter<Color>.
+    const float *rgb = (const float *) image.at(0, 0);
+    for (std::size_t i = 0; i < n; ++i) myBytes[i] = (unsigned char) (rgb[i] * 255.0f);
+    myOutput.write((const char *) myBytes.data(), (std::streamsize) n);
+    myOutput.flush();
+    if (!myOutput.good()) {
+        std::cerr << "[RawFrameSink::writeFrame] Unable to write frame " << frame << "." << std::endl;
+        return false;
+    }
+    return true;
+}
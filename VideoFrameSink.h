@@ -0,0 +1,73 @@
+/**
+@file VideoFrameSink.h
+*/
+#pragma once
+#ifndef _VIDEO_FRAME_SINK_H_
+#define _VIDEO_FRAME_SINK_H_
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include "FrameSink.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A sink streaming all the frames into one YUV4MPEG2 video (a header,
+  /// then the planes Y, Cb and Cr of each frame), as read by video
+  /// encoders (e.g. ffmpeg -i film.y4m, or from a pipe). No file is
+  /// written per frame.
+  ///
+  /// Colors are converted to YCbCr as in BT.601 (Y in [16,235]) a row at
+  /// a time (toYCbCr), then rounded into the planes. The chroma is
+  /// averaged on blocks of 2x2 pixels (4:2:0, the format expected by most
+  /// encoders) unless subsampling is disabled (4:4:4).
+  struct Y4MFrameSink : public FrameSink {
+
+    /// Constructor. Frames are written into \a output, at \a fps frames
+    /// per second.
+    Y4MFrameSink( std::ostream& output, int fps = 25, bool subsample = true )
+      : myOutput( output ), myFPS( fps ), mySubsample( subsample ) {}
+
+    /// Writes the header before the first frame. All frames must have
+    /// the size of the first one.
+    bool writeFrame( int frame, Image2D<Color>& image );
+
+    /// Converts the \a n colors \a rgb (3 floats each, clamped) into
+    /// lumas \a y and chromas \a cb and \a cr (in [0,255], not rounded).
+    static void toYCbCr( const float* rgb, std::size_t n, float* y, float* cb, float* cr );
+
+  private:
+    std::ostream& myOutput;
+    int myFPS;
+    bool mySubsample;
+    /// Size of the frames (0 before the first one).
+    int myWidth = 0, myHeight = 0;
+    /// Y, Cb and Cr of two rows of pixels.
+    std::vector<float> myY, myCb, myCr;
+    /// The planes of the frame being written.
+    std::vector<unsigned char> myPlanes;
+  };
+
+  /// A sink streaming all the frames into one raw video of 8 bits RGB
+  /// pixels (the bytes of the PPM images, without headers), e.g. for
+  /// ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i film.rgb.
+  struct RawFrameSink : public FrameSink {
+
+    /// Constructor. Frames are written into \a output.
+    RawFrameSink( std::ostream& output ) : myOutput( output ) {}
+
+    /// All frames must have the size of the first one.
+    bool writeFrame( int frame, Image2D<Color>& image );
+
+  private:
+    std::ostream& myOutput;
+    /// Size of the frames (0 before the first one).
+    int myWidth = 0, myHeight = 0;
+    /// The bytes of the frame being written.
+    std::vector<unsigned char> myBytes;
+  };
+
+} // namespace rt
+
+#endif // #define _VIDEO_FRAME_SINK_H_
@@ -6,8 +6,10 @@
 #include "Viewer.h"
 #include "Scene.h"
 #include "Renderer.h"
+#include "Camera.h"
 #include "Image2D.h"
 #include "Image2DWriter.h"
+#include "SequenceRenderer.h"
 
 using namespace std;
 
@@ -30,12 +32,29 @@ rt::Viewer::init()
   // Restore previous viewer state.
   restoreStateFromFile();
 
+  // Place the camera as specified by the scene.
+  if ( ptrCamera != 0 )
+    {
+      camera()->setPosition( qglviewer::Vec( ptrCamera->position[ 0 ],
+                                             ptrCamera->position[ 1 ],
+                                             ptrCamera->position[ 2 ] ) );
+      camera()->setUpVector( qglviewer::Vec( ptrCamera->up[ 0 ],
+                                             ptrCamera->up[ 1 ],
+                                             ptrCamera->up[ 2 ] ) );
+      camera()->lookAt( qglviewer::Vec( ptrCamera->target[ 0 ],
+                                        ptrCamera->target[ 1 ],
+                                        ptrCamera->target[ 2 ] ) );
+      camera()->setFieldOfView( ptrCamera->fov * M_PI / 180.0 );
+    }
+
   // Add custom key description (see keyPressEvent).
   setKeyDescription(Qt::Key_R, "Renders the scene with a ray-tracer (low resolution)");
   setKeyDescription(Qt::SHIFT+Qt::Key_R, "Renders the scene with a ray-tracer (medium resolution)");
   setKeyDescription(Qt::CTRL+Qt::Key_R, "Renders the scene with a ray-tracer (high resolution)");
   setKeyDescription(Qt::Key_D, "Augments the max depth of ray-tracing algorithm");
   setKeyDescription(Qt::SHIFT+Qt::Key_D, "Decreases the max depth of ray-tracing algorithm");
+  setKeyDescription(Qt::Key_G, "Forgets the region to render (Ctrl+Shift+drag selects one)");
+  setKeyDescription(Qt::Key_M, "Renders the film of the camera path F1 (medium resolution)");
   
   // Opens help window
   help();
@@ -63,6 +82,7 @@ rt::Viewer::keyPressEvent(QKeyEvent *e)
       int w = camera()->screenWidth();
       int h = camera()->screenHeight();
       Renderer renderer( *ptrScene );
+      if ( hasBackground ) renderer.ptrBackground = ptrBackground;
       qglviewer::Vec orig, dir;
       camera()->convertClickToLine( QPoint( 0,0 ), orig, dir );
       Vector3 origin( orig );
@@ -76,14 +96,63 @@ rt::Viewer::keyPressEvent(QKeyEvent *e)
       renderer.setViewBox( origin, dirUL, dirUR, dirLL, dirLR );
       if ( modifiers == Qt::ShiftModifier ) { w /= 2; h /= 2; }
       else if ( modifiers == Qt::NoModifier ) { w /= 8; h /= 8; }
-      Image2D<Color> image( w, h );
-      renderer.setResolution( image.w(), image.h() );
-      renderer.render( image, maxDepth );
+      // The region is scaled like the image. Pixels outside it are the
+      // ones of the last image, when it has the same size.
+      if ( hasRegion )
+        {
+          int W = camera()->screenWidth();
+          int H = camera()->screenHeight();
+          int x0 = std::min( regionStart.x(), regionEnd.x() );
+          int x1 = std::max( regionStart.x(), regionEnd.x() );
+          int y0 = std::min( regionStart.y(), regionEnd.y() );
+          int y1 = std::max( regionStart.y(), regionEnd.y() );
+          renderer.setRegion( x0 * w / W, y0 * h / H,
+                              ( x1 * w + W - 1 ) / W, ( y1 * h + H - 1 ) / H );
+        }
+      renderer.setResolution( w, h );
+      renderer.render( lastImage, maxDepth );
       ofstream output( "output.ppm" );
-      Image2DWriter<Color>::write( image, output, true );
+      Image2DWriter<Color>::write( lastImage, output, true );
       output.close();
       handled = true;
     }
+  if ( e->key()==Qt::Key_M && modifiers == Qt::NoModifier && ptrScene != 0 )
+    {
+      // The keyframes of the path F1 (added with Alt+F1), at 25 frames
+      // per second.
+      qglviewer::KeyFrameInterpolator* kfi = camera()->keyFrameInterpolator( 1 );
+      if ( kfi != 0 && kfi->numberOfKeyFrames() > 0 )
+        {
+          CameraPath path;
+          for ( int i = 0; i < kfi->numberOfKeyFrames(); ++i )
+            {
+              const qglviewer::Frame& frame = kfi->keyFrame( i );
+              Camera key;
+              key.position = Point3( frame.position() );
+              key.target = key.position
+                + Vector3( frame.orientation().rotate( qglviewer::Vec( 0, 0, -1 ) ) );
+              key.up = Vector3( frame.orientation().rotate( qglviewer::Vec( 0, 1, 0 ) ) );
+              key.fov = camera()->fieldOfView() * 180.0 / M_PI;
+              path.addKeyFrame( kfi->keyFrameTime( i ), key );
+            }
+          int nb_frames = 1 + (int) ( 25.0f * ( path.lastTime() - path.firstTime() ) );
+          Renderer renderer( *ptrScene );
+          if ( hasBackground ) renderer.ptrBackground = ptrBackground;
+          SequenceRenderer sequence( renderer );
+          PPMFrameSink sink( "film%04d.ppm" );
+          sequence.render( path, nb_frames, camera()->screenWidth() / 2,
+                           camera()->screenHeight() / 2, maxDepth, sink );
+        }
+      else
+        std::cout << "Add keyframes to the path F1 with Alt+F1." << std::endl;
+      handled = true;
+    }
+  if ( e->key()==Qt::Key_G && modifiers == Qt::NoModifier )
+    {
+      hasRegion = false;
+      update();
+      handled = true;
+    }
   if (e->key()==Qt::Key_D)
     {
       if ( modifiers == Qt::ShiftModifier )
@@ -96,6 +165,68 @@ rt::Viewer::keyPressEvent(QKeyEvent *e)
   if (!handled) QGLViewer::keyPressEvent(e);
 }
 
+void
+rt::Viewer::postDraw()
+{
+  QGLViewer::postDraw();
+  if ( ! hasRegion ) return;
+  startScreenCoordinatesSystem();
+  glPushAttrib( GL_ENABLE_BIT | GL_CURRENT_BIT );
+  glDisable( GL_LIGHTING );
+  glDisable( GL_DEPTH_TEST );
+  glColor3f( 1.0f, 1.0f, 0.0f );
+  glBegin( GL_LINE_LOOP );
+  glVertex2i( regionStart.x(), regionStart.y() );
+  glVertex2i( regionEnd.x(), regionStart.y() );
+  glVertex2i( regionEnd.x(), regionEnd.y() );
+  glVertex2i( regionStart.x(), regionEnd.y() );
+  glEnd();
+  glPopAttrib();
+  stopScreenCoordinatesSystem();
+}
+
+void
+rt::Viewer::mousePressEvent(QMouseEvent *e)
+{
+  if ( e->button() == Qt::LeftButton
+       && e->modifiers() == ( Qt::ControlModifier | Qt::ShiftModifier ) )
+    {
+      selectingRegion = true;
+      hasRegion = true;
+      regionStart = regionEnd = e->pos();
+      update();
+    }
+  else
+    QGLViewer::mousePressEvent( e );
+}
+
+void
+rt::Viewer::mouseMoveEvent(QMouseEvent *e)
+{
+  if ( selectingRegion )
+    {
+      regionEnd = e->pos();
+      update();
+    }
+  else
+    QGLViewer::mouseMoveEvent( e );
+}
+
+void
+rt::Viewer::mouseReleaseEvent(QMouseEvent *e)
+{
+  if ( selectingRegion )
+    {
+      selectingRegion = false;
+      regionEnd = e->pos();
+      // A click without drag forgets the region.
+      hasRegion = regionStart.x() != regionEnd.x() && regionStart.y() != regionEnd.y();
+      update();
+    }
+  else
+    QGLViewer::mouseReleaseEvent( e );
+}
+
 QString 
 rt::Viewer::helpString() const
 {
@@ -117,5 +248,8 @@ rt::Viewer::helpString() const
   text += "Press <b>R</b> to render the scene (low resolution).";
   text += "Press <b>Shift+R</b> to render the scene (medium resolution).";
   text += "Press <b>Ctrl+R</b> to render the scene (high resolution).";
+  text += "Drag with <b>Ctrl+Shift</b> and the left button to only render a region again, ";
+  text += "and press <b>G</b> to render the whole image.";
+  text += "Press <b>M</b> to render the film of the camera path <b>F1</b> into film0000.ppm, film0001.ppm, etc.";
   return text;
 }
@@ -8,12 +8,19 @@
 
 #include <vector>
 #include <QKeyEvent>
+#include <QMouseEvent>
 #include <QGLViewer/qglviewer.h>
+#include "Color.h"
+#include "Image2D.h"
 
 namespace rt {
   
   /// Forward declaration of class Scene
   struct Scene;
+  /// Forward declaration of class Camera
+  struct Camera;
+  /// Forward declaration of class Background
+  struct Background;
 
   /// This class displays the interface for placing the camera and the
   /// lights, and the user may call the renderer from it.
@@ -21,13 +28,29 @@ namespace rt {
   {
   public:
     /// Default constructor. Scene is empty.
-    Viewer() : QGLViewer(), ptrScene( 0 ), maxDepth( 6 ) {}
+    Viewer() : QGLViewer(), ptrScene( 0 ), ptrCamera( 0 ), ptrBackground( 0 ),
+               hasBackground( false ), maxDepth( 6 ),
+               hasRegion( false ), selectingRegion( false ) {}
     
     /// Sets the scene
     void setScene( rt::Scene& aScene )
     {
       ptrScene = &aScene;
     }
+
+    /// Sets the initial camera (otherwise the one of the previous
+    /// session is restored).
+    void setCamera( const rt::Camera& aCamera )
+    {
+      ptrCamera = &aCamera;
+    }
+
+    /// Sets the background used by the renderer (0 for black).
+    void setBackground( rt::Background* aBackground )
+    {
+      ptrBackground = aBackground;
+      hasBackground = true;
+    }
     
     /// To call the protected method `drawLight`.
     void drawSomeLight( GLenum light ) const
@@ -49,12 +72,35 @@ namespace rt {
     virtual QString helpString() const;
     /// Celled when pressing a key.
     virtual void keyPressEvent(QKeyEvent *e);
+    /// Called after draw, displays the region to render (if any).
+    virtual void postDraw();
+    /// Ctrl+Shift+left button drags the region to render, the other
+    /// mouse events move the camera.
+    virtual void mousePressEvent(QMouseEvent *e);
+    virtual void mouseMoveEvent(QMouseEvent *e);
+    virtual void mouseReleaseEvent(QMouseEvent *e);
     
     /// Stores the scene
     rt::Scene* ptrScene;
+    /// Stores the initial camera (if any)
+    const rt::Camera* ptrCamera;
+    /// Stores the background given to the renderer
+    rt::Background* ptrBackground;
+    /// 'true' when the background was set
+    bool hasBackground;
 
     /// Maximum depth
     int maxDepth;
+
+    /// The last rendered image. When a region is selected, only its
+    /// pixels are rendered again, the other ones are kept.
+    rt::Image2D<rt::Color> lastImage;
+    /// 'true' when a region of the window is selected.
+    bool hasRegion;
+    /// 'true' while the region is being dragged.
+    bool selectingRegion;
+    /// Corners of the region, in pixels of the window.
+    QPoint regionStart, regionEnd;
   };
 }
 
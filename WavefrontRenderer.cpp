@@ -0,0 +1,370 @@
+/**
+@file WavefrontRenderer.cpp
+*/
+#include <algorithm>
+#include <chrono>
+#include "WavefrontRenderer.h"
+#include "Morton.h"
+
+void
+rt::WavefrontRenderer::render(Image2D<Color> &image, int max_depth) {
+    // Pixels outside the region or the mask keep their value.
+    if (image.w() == myWidth && image.h() == myHeight && (myHasRegion || ptrMask != 0))
+        myFramebuffer = Image2D<Color, TiledLayout<TILE_SIZE> >(image);
+    else
+        myFramebuffer = Image2D<Color, TiledLayout<TILE_SIZE> >(myWidth, myHeight);
+    ImageTileSink<Color, TiledLayout<TILE_SIZE> > sink(myFramebuffer);
+    render(sink, max_depth);
+    image = Image2D<Color>(myFramebuffer);
+}
+
+void
+rt::WavefrontRenderer::render(TileSink &sink, int max_depth) {
+    beginTiles();
+    std::vector<Tile> tiles;
+    regionTiles(tiles);
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        const Tile &t = tiles[i];
+        progressBar(std::cout, (Real) i / (Real) tiles.size(), 1.0);
+        if (!restoreTile(t)) {
+            renderTile(t.x0, t.y0, t.x1, t.y1, max_depth);
+            if (ptrCheckpoint != 0) ptrCheckpoint->add(t.index, t.x0, t.y0, t.x1, t.y1, myTile.data());
+        }
+        sink.writeTile(t.x0, t.y0, t.x1, t.y1, myTile.data(), ptrMask != 0 ? myTileRendered.data() : 0);
+    }
+    endTiles();
+}
+
+void
+rt::WavefrontRenderer::beginTiles() {
+    beginRender();
+    mySecondaryRays = 0;
+    myIntersectionTime = 0.0;
+    mySortTime = 0.0;
+}
+
+void
+rt::WavefrontRenderer::endTiles() {
+    endRender();
+    std::cout << mySecondaryRays << " reflected and refracted rays, intersected in "
+              << myIntersectionTime << " s";
+    if (mySortRays) std::cout << ", sorted in " << mySortTime << " s";
+    std::cout << "." << std::endl;
+}
+
+void
+rt::WavefrontRenderer::regionTiles(std::vector<Tile> &tiles) const {
+    // Tiles stay aligned on the ones of the whole image.
+    int rx0, ry0, rx1, ry1;
+    region(rx0, ry0, rx1, ry1);
+    tiles.clear();
+    for (int ty = ry0 - ry0 % TILE_SIZE; ty < ry1; ty += TILE_SIZE)
+        for (int tx = rx0 - rx0 % TILE_SIZE; tx < rx1; tx += TILE_SIZE) {
+            Tile t;
+            t.index = (ty / TILE_SIZE) * TiledLayout<TILE_SIZE>::tiles(myWidth) + tx / TILE_SIZE;
+            t.x0 = std::max(tx, rx0);
+            t.x1 = std::min(tx + TILE_SIZE, rx1);
+            t.y0 = std::max(ty, ry0);
+            t.y1 = std::min(ty + TILE_SIZE, ry1);
+            tiles.push_back(t);
+        }
+}
+
+bool
+rt::WavefrontRenderer::restoreTile(const Tile &t) {
+    if (ptrCheckpoint == 0 || !ptrCheckpoint->restore(t.index, t.x0, t.y0, t.x1, t.y1, myTile))
+        return false;
+    maskTile(t.x0, t.y0, t.x1, t.y1);
+    return true;
+}
+
+void
+rt::WavefrontRenderer::maskTile(int x0, int y0, int x1, int y1) {
+    myTileRendered.clear();
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x) myTileRendered.push_back(isRendered(x, y));
+}
+
+void
+rt::WavefrontRenderer::renderTile(int x0, int y0, int x1, int y1, int max_depth) {
+    int w = x1 - x0;
+    myNodes.clear();
+    myWave.clear();
+    myRandoms.resize(w * (y1 - y0));
+    maskTile(x0, y0, x1, y1);
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x) {
+            PathNode node;
+            node.ray = eyeRay(x, y, max_depth);
+            node.pixel = (y - y0) * w + (x - x0);
+            node.has_hit = false;
+            node.result = Color(0.0, 0.0, 0.0);
+            // Pixels outside the mask keep a node, which is not traced.
+            if (myTileRendered[node.pixel]) {
+                myRandoms[node.pixel].seed((std::uint32_t) (y * myWidth + x));
+                myWave.push_back((int) myNodes.size());
+            }
+            myNodes.push_back(node);
+        }
+    bool secondary = false; // the first wave holds the eye rays
+    while (!myWave.empty()) {
+        if (secondary) {
+            mySecondaryRays += (long) myWave.size();
+            if (mySortRays) {
+                auto t0 = std::chrono::steady_clock::now();
+                sortWave();
+                mySortTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            intersectWave();
+            myIntersectionTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        } else
+            intersectWave();
+        secondary = true;
+        pickLights();
+        traceShadows();
+        shade();
+        spawnRays();
+        myWave.swap(myNextWave);
+    }
+    combine();
+    // Eye rays are the first nodes, in the order of the pixels.
+    myTile.resize(w * (y1 - y0));
+    for (std::size_t i = 0; i < myTile.size(); ++i) myTile[i] = myNodes[i].result.clamp();
+}
+
+void
+rt::WavefrontRenderer::sortWave() {
+    BoundingBox box;
+    for (int n : myWave) box.extend(myNodes[n].ray.origin);
+    Vector3 scale;
+    for (int i = 0; i < 3; ++i)
+        scale[i] = box.hi[i] > box.lo[i] ? 1023.0f / (box.hi[i] - box.lo[i]) : 0.0f;
+    myKeys.clear();
+    for (int n : myWave) {
+        const Ray &ray = myNodes[n].ray;
+        std::uint32_t cell[3];
+        std::uint64_t octant = 0;
+        for (int i = 0; i < 3; ++i) {
+            cell[i] = (std::uint32_t) ((ray.origin[i] - box.lo[i]) * scale[i]);
+            if (ray.direction[i] < 0.0f) octant |= 1u << i;
+        }
+        std::uint64_t key = (octant << 30) | Morton::code3(cell[0], cell[1], cell[2]);
+        myKeys.push_back(std::make_pair(key, n));
+    }
+    std::sort(myKeys.begin(), myKeys.end());
+    for (std::size_t i = 0; i < myKeys.size(); ++i) myWave[i] = myKeys[i].second;
+}
+
+void
+rt::WavefrontRenderer::intersectWave() {
+    myHits.clear();
+    for (int n : myWave) {
+        PathNode &node = myNodes[n];
+        GraphicalObject *obj_i = 0;
+        node.has_hit = ptrScene->rayIntersection(node.ray, obj_i, node.hit) < 0.0f;
+        node.reflected = node.refracted = -1;
+        if (node.has_hit) {
+            node.illumination = Color(0.0, 0.0, 0.0);
+            node.material_key = materialKey(node.hit.material);
+            myHits.push_back(n);
+        } else
+            node.result = background(node.ray);
+    }
+}
+
+void
+rt::WavefrontRenderer::pickLights() {
+    myQueries.clear();
+    ShadowQuery q;
+    for (int n : myHits) {
+        PathNode &node = myNodes[n];
+        const Point3 &p = node.hit.point;
+        node.first_query = (int) myQueries.size();
+        q.node = n;
+        q.weight = 1.0f;
+        // Same choices as Renderer::illumination.
+        if (myLightSamples > 0 && myLightTree.size() > myLightSamples) {
+            for (Light *light : myLightTree.unclustered()) {
+                q.light = light;
+                q.sample = light->sample(p);
+                myQueries.push_back(q);
+            }
+            myRandom = myRandoms[node.pixel];
+            for (int k = 0; k < myLightSamples; ++k) {
+                Real pdf;
+                Light *light = myLightTree.sample(p, node.hit.normal, myRandom.uniform(), pdf);
+                if (light == 0) continue;
+                q.light = light;
+                q.weight = 1.0f / (pdf * myLightSamples);
+                q.sample = light->sample(p);
+                myQueries.push_back(q);
+            }
+            myRandoms[node.pixel] = myRandom;
+        } else {
+            for (Light *light : ptrScene->myLights) {
+                q.light = light;
+                q.sample = light->sample(p);
+                myQueries.push_back(q);
+            }
+        }
+        node.nb_queries = (int) myQueries.size() - node.first_query;
+    }
+}
+
+void
+rt::WavefrontRenderer::traceShadows() {
+    for (ShadowQuery &q : myQueries) {
+        const Point3 &p = myNodes[q.node].hit.point;
+        if (q.light->hasArea()) {
+            Random &random = myRandoms[myNodes[q.node].pixel];
+            myRandom = random;
+            q.color = softShadow(*q.light, p);
+            random = myRandom;
+        } else
+            q.color = shadow(Ray(p, q.sample.direction), q.sample.color, q.sample.distance, q.light);
+    }
+}
+
+void
+rt::WavefrontRenderer::shade() {
+    // Hits are sorted by (key, node) and the queries of a node are in
+    // the order of its lights, so that colors are summed as in Renderer.
+    myBins.clear();
+    for (int n : myHits) myBins.push_back(std::make_pair(myNodes[n].material_key, n));
+    std::sort(myBins.begin(), myBins.end());
+    myBinQueries.clear();
+    for (std::size_t b = 0; b < myBins.size();) {
+        std::size_t first = myBinQueries.size();
+        std::size_t e = b;
+        for (; e < myBins.size() && myBins[e].first == myBins[b].first; ++e) {
+            const PathNode &node = myNodes[myBins[e].second];
+            for (int i = 0; i < node.nb_queries; ++i) myBinQueries.push_back(node.first_query + i);
+        }
+        shadeBin(first, myBinQueries.size());
+        b = e;
+    }
+    for (int n : myHits)
+        myNodes[n].illumination += myNodes[n].hit.material.ambient;
+}
+
+void
+rt::WavefrontRenderer::shadeBin(std::size_t b, std::size_t e) {
+    std::size_t n = e - b;
+    PhongBatch &batch = myPhong;
+    batch.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const ShadowQuery &q = myQueries[myBinQueries[b + i]];
+        const PathNode &node = myNodes[q.node];
+        Vector3 r = reflect(node.ray.direction, node.hit.normal);
+        batch.lx[i] = q.sample.direction[0];
+        batch.ly[i] = q.sample.direction[1];
+        batch.lz[i] = q.sample.direction[2];
+        batch.nx[i] = node.hit.normal[0];
+        batch.ny[i] = node.hit.normal[1];
+        batch.nz[i] = node.hit.normal[2];
+        batch.rx[i] = r[0];
+        batch.ry[i] = r[1];
+        batch.rz[i] = r[2];
+        batch.shininess[i] = node.hit.material.shinyness;
+    }
+    phongCosines(batch, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const ShadowQuery &q = myQueries[myBinQueries[b + i]];
+        PathNode &node = myNodes[q.node];
+        const Material &m = node.hit.material;
+        Color temp_light_color = q.color * q.weight;
+        node.illumination += batch.diffuse[i] * m.diffuse * temp_light_color;
+        if (batch.specular[i] >= 0)
+            node.illumination += batch.specular[i] * m.specular * temp_light_color;
+    }
+}
+
+void
+rt::WavefrontRenderer::phongCosines(PhongBatch &batch, std::size_t n) {
+    const Real *lx = batch.lx.data(), *ly = batch.ly.data(), *lz = batch.lz.data();
+    const Real *nx = batch.nx.data(), *ny = batch.ny.data(), *nz = batch.nz.data();
+    const Real *rx = batch.rx.data(), *ry = batch.ry.data(), *rz = batch.rz.data();
+    Real *diffuse = batch.diffuse.data(), *specular = batch.specular.data();
+    // The dot products are computed for the whole bin first, and powf,
+    // which is a call, only in a second loop over the lit points.
+    for (std::size_t i = 0; i < n; ++i) {
+        Real d = lx[i] * nx[i] + ly[i] * ny[i] + lz[i] * nz[i];
+        diffuse[i] = d < 0 ? 0 : d;
+        specular[i] = lx[i] * rx[i] + ly[i] * ry[i] + lz[i] * rz[i];
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        if (specular[i] >= 0) specular[i] = powf(specular[i], batch.shininess[i]);
+        else specular[i] = -1.0f;
+}
+
+std::uint32_t
+rt::WavefrontRenderer::materialKey(const Material &m) {
+    // FNV-1a hash of the bytes of the material (only floats, no padding).
+    const unsigned char *bytes = (const unsigned char *) &m;
+    std::uint32_t h = 2166136261u;
+    for (std::size_t i = 0; i < sizeof(Material); ++i) h = (h ^ bytes[i]) * 16777619u;
+    return h;
+}
+
+void
+rt::WavefrontRenderer::PhongBatch::resize(std::size_t n) {
+    for (std::vector<Real> *v : {&lx, &ly, &lz, &nx, &ny, &nz, &rx, &ry, &rz,
+                                 &shininess, &diffuse, &specular})
+        if (v->size() < n) v->resize(n);
+}
+
+void
+rt::WavefrontRenderer::spawnRays() {
+    myNextWave.clear();
+    PathNode child;
+    for (int n : myHits) {
+        // Same rays as Renderer::trace. They are computed before being
+        // added, since myNodes may then move.
+        const PathNode &node = myNodes[n];
+        const Material &m = node.hit.material;
+        bool reflects = node.ray.depth > 0 && m.coef_reflexion != 0;
+        bool refracts = node.ray.depth > 0 && m.coef_refraction != 0;
+        child.pixel = node.pixel;
+        Ray reflected, refracted;
+        if (reflects) {
+            reflected = Ray(node.ray.origin, reflect(node.ray.direction, node.hit.normal));
+            reflected.depth--;
+        }
+        if (refracts) {
+            refracted = refractionRay(node.ray, node.hit.point, node.hit.normal, m);
+            refracted.depth--;
+        }
+        if (reflects) {
+            child.ray = reflected;
+            myNodes[n].reflected = (int) myNodes.size();
+            myNextWave.push_back((int) myNodes.size());
+            myNodes.push_back(child);
+        }
+        if (refracts) {
+            child.ray = refracted;
+            myNodes[n].refracted = (int) myNodes.size();
+            myNextWave.push_back((int) myNodes.size());
+            myNodes.push_back(child);
+        }
+    }
+}
+
+void
+rt::WavefrontRenderer::combine() {
+    for (int n = (int) myNodes.size() - 1; n >= 0; --n) {
+        PathNode &node = myNodes[n];
+        if (!node.has_hit) continue;
+        const Material &m = node.hit.material;
+        Color result = Color(0.0, 0.0, 0.0);
+        if (node.reflected >= 0)
+            result += myNodes[node.reflected].result * m.specular * m.coef_reflexion;
+        if (node.refracted >= 0)
+            result += myNodes[node.refracted].result * m.diffuse * m.coef_refraction;
+        if (node.ray.depth > 0)
+            result += node.illumination * m.coef_diffusion;
+        else
+            result += node.illumination;
+        node.result = result;
+    }
+}
@@ -0,0 +1,198 @@
+/**
+@file WavefrontRenderer.h
+*/
+#pragma once
+#ifndef _WAVEFRONT_RENDERER_H_
+#define _WAVEFRONT_RENDERER_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Renderer.h"
+#include "TileSink.h"
+#include "Checkpoint.h"
+
+/// Namespace RayTracer
+namespace rt {
+
+  /// A renderer processing the rays of a tile of the image in waves
+  /// instead of one after the other: all the rays of a wave are
+  /// intersected, then all the hit points pick their lights, then all
+  /// the shadow rays are traced, then the Phong model is evaluated for
+  /// all of them, and the reflected and refracted rays form the next
+  /// wave. Each stage is a loop over a queue doing one kind of work,
+  /// which is the structure needed to batch or vectorize a stage.
+  ///
+  /// The rays of a tile form a tree (a ray and its reflected and
+  /// refracted rays), whose colors are combined from the leaves once
+  /// all waves are done, in the same order as Renderer::trace. Images
+  /// are thus the same as the ones of Renderer, except for random
+  /// choices (lights or points on area lights), which are done in
+  /// another order for each pixel.
+  ///
+  /// Reflected and refracted rays go in all directions. When sorting is
+  /// enabled (setSortRays), the waves after the first one are sorted by
+  /// octant of direction, then by cell of origin along a Morton curve,
+  /// so that consecutive rays traverse the same parts of the scene.
+  ///
+  /// Shading is deferred: the lights of the hit points of a wave are
+  /// binned by material, and each bin is shaded in one batch. The
+  /// cosines of the Phong model of a bin are computed by a loop over
+  /// plain arrays of floats (phongCosines), which the compiler can
+  /// vectorize.
+  struct WavefrontRenderer : public Renderer {
+
+    /// Width and height of the tiles.
+    static const int TILE_SIZE = 32;
+
+    WavefrontRenderer() : Renderer() {}
+    WavefrontRenderer( Scene& scene ) : Renderer( scene ) {}
+
+    /// The main rendering routine.
+    void render( Image2D<Color>& image, int max_depth );
+
+    /// Renders the image tile by tile into \a sink, without storing
+    /// the whole image (see MappedImage). Only the tiles meeting the
+    /// region are rendered, clipped to it.
+    virtual void render( TileSink& sink, int max_depth );
+
+    /// Enables or disables the sorting of reflected and refracted rays
+    /// before their intersection.
+    void setSortRays( bool sort ) { mySortRays = sort; }
+
+    /// Sets the checkpoint (opened for the size of the image and
+    /// TILE_SIZE) which keeps the rendered tiles, or 0 for none. Tiles
+    /// found in it are not rendered again.
+    void setCheckpoint( Checkpoint* checkpoint ) { ptrCheckpoint = checkpoint; }
+
+  protected:
+    /// A tile of the image, clipped to the region.
+    struct Tile {
+      /// index of the tile among the tiles of the whole image
+      int index;
+      int x0, y0, x1, y1;
+    };
+
+    /// A ray of the tile being rendered.
+    struct PathNode {
+      Ray ray;
+      /// the point hit by the ray (if hit)
+      RayHit hit;
+      bool has_hit;
+      /// index of the pixel in the tile
+      int pixel;
+      /// identifies the material of hit (equal materials have equal keys)
+      std::uint32_t material_key;
+      /// the queries of the lights of the node are myQueries[first_query,
+      /// first_query + nb_queries[
+      int first_query, nb_queries;
+      /// nodes of the reflected and refracted rays, or -1
+      int reflected, refracted;
+      /// light received at the hit point (Renderer::illumination)
+      Color illumination;
+      /// the color of the ray
+      Color result;
+    };
+
+    /// A light to evaluate at the hit point of a node.
+    struct ShadowQuery {
+      int node;
+      const Light* light;
+      /// the weight of the light (see Renderer::illumination)
+      Real weight;
+      LightSample sample;
+      /// the light that is not stopped by objects
+      Color color;
+    };
+
+    /// The rays of the tile, eye rays first. Each ray comes after the
+    /// ray it comes from.
+    std::vector<PathNode> myNodes;
+    /// The nodes of the current wave, and the ones of the next wave.
+    std::vector<int> myWave, myNextWave;
+    /// The nodes of the current wave whose ray hit an object.
+    std::vector<int> myHits;
+    /// The lights to evaluate in the current wave.
+    std::vector<ShadowQuery> myQueries;
+    /// The image being rendered, stored tile by tile so that each tile
+    /// is written in one block of memory. It is converted to a row by
+    /// row image at the end of render.
+    Image2D<Color, TiledLayout<TILE_SIZE> > myFramebuffer;
+    /// The colors of the tile being rendered, row by row, and the
+    /// pixels of the mask among them (when there is a mask).
+    std::vector<Color> myTile;
+    std::vector<unsigned char> myTileRendered;
+    /// The random generator of each pixel of the tile.
+    std::vector<Random> myRandoms;
+    /// The sort keys of the current wave, with their nodes.
+    std::vector<std::pair<std::uint64_t, int> > myKeys;
+    /// The hits of the current wave sorted by material key, and their
+    /// queries in this order.
+    std::vector<std::pair<std::uint32_t, int> > myBins;
+    std::vector<int> myBinQueries;
+
+    /// The inputs and outputs of phongCosines for a bin, one array per
+    /// coordinate.
+    struct PhongBatch {
+      /// directions of the lights, normals, reflected view directions
+      std::vector<Real> lx, ly, lz, nx, ny, nz, rx, ry, rz;
+      std::vector<Real> shininess;
+      /// diffuse cosines (>= 0) and specular terms (< 0 when none)
+      std::vector<Real> diffuse, specular;
+      void resize( std::size_t n );
+    };
+    PhongBatch myPhong;
+
+    /// Tells if waves of reflected and refracted rays are sorted.
+    bool mySortRays = false;
+    /// Keeps the rendered tiles (if not 0).
+    Checkpoint* ptrCheckpoint = 0;
+    /// Number of reflected and refracted rays, time spent intersecting
+    /// them and time spent sorting them, during the last render.
+    long mySecondaryRays = 0;
+    double myIntersectionTime = 0.0;
+    double mySortTime = 0.0;
+
+    /// Prepares the renderer and its statistics for the tiles of an
+    /// image (see Renderer::beginRender).
+    void beginTiles();
+    /// Displays the statistics of the image.
+    void endTiles();
+    /// Gives the tiles meeting the region, in rendering order.
+    void regionTiles( std::vector<Tile>& tiles ) const;
+    /// Gets the tile \a t from the checkpoint into myTile, if it holds it.
+    /// @return 'true' if the tile was restored.
+    bool restoreTile( const Tile& t );
+    /// Fills myTileRendered for the pixels [x0,x1[ x [y0,y1[.
+    void maskTile( int x0, int y0, int x1, int y1 );
+    /// Renders the pixels [x0,x1[ x [y0,y1[ into myTile.
+    void renderTile( int x0, int y0, int x1, int y1, int max_depth );
+
+    /// Sorts myWave by octant of direction and Morton code of origin.
+    void sortWave();
+    /// Intersects the rays of myWave with the scene, filling myHits.
+    /// Rays hitting nothing get the background color.
+    void intersectWave();
+    /// Picks the lights of the points of myHits, filling myQueries.
+    void pickLights();
+    /// Traces the shadow rays of myQueries.
+    void traceShadows();
+    /// Evaluates the Phong model for myQueries, bin by bin, and the
+    /// ambient light.
+    void shade();
+    /// Evaluates the Phong model for the queries myBinQueries[b..e[.
+    void shadeBin( std::size_t b, std::size_t e );
+    /// Computes the diffuse cosines and the specular terms of the \a n
+    /// first entries of \a batch (same results as Renderer::addPhong).
+    static void phongCosines( PhongBatch& batch, std::size_t n );
+    /// @return the key of the material \a m.
+    static std::uint32_t materialKey( const Material& m );
+    /// Creates the reflected and refracted rays of myHits into myNextWave.
+    void spawnRays();
+    /// Combines the colors of all nodes, from the last ones.
+    void combine();
+  };
+
+} // namespace rt
+
+#endif // #define _WAVEFRONT_RENDERER_H_
@@ -1,38 +1,60 @@
 #include <qapplication.h>
+#include <chrono>
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <memory>
 #include <math.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include "Viewer.h"
 #include "Scene.h"
 #include "Sphere.h"
 #include "Material.h"
 #include "PointLight.h"
+#include "SphereSet.h"
+#include "Instance.h"
+#include "SceneReader.h"
+#include "CompiledSceneReader.h"
+#include "CompiledSceneWriter.h"
+#include "EnvironmentMap.h"
+#include "Renderer.h"
+#include "WavefrontRenderer.h"
+#include "DistributedRenderer.h"
+#include "MappedImage.h"
+#include "Checkpoint.h"
+#include "RenderServer.h"
+#include "SequenceRenderer.h"
+#include "VideoFrameSink.h"
+#include "Image2DReader.h"
+#include "Image2DWriter.h"
 
 using namespace std;
 using namespace rt;
 
-void addBubble(Scene &scene, Point3 c, Real r, Material transp_m) {
-    Material revert_m = transp_m;
-    std::swap(revert_m.in_refractive_index, revert_m.out_refractive_index);
-    Sphere *sphere_out = new Sphere(c, r, transp_m);
-    Sphere *sphere_in = new Sphere(c, r - 0.02f, revert_m);
-    scene.addObject(sphere_out);
-    scene.addObject(sphere_in);
+/// A bubble of radius \a r centered at the origin, made of a thin shell,
+/// shared by all the bubbles placed by addBubble.
+std::shared_ptr<GraphicalObject> makeBubble(Real r, Material transp_m) {
+    SphereSet *bubble = new SphereSet;
+    bubble->addShell(Point3(0, 0, 0), r, SceneReader::BUBBLE_THICKNESS, bubble->addMaterial(transp_m));
+    bubble->buildIndex();
+    return std::shared_ptr<GraphicalObject>(bubble);
+}
+
+void addBubble(Scene &scene, const std::shared_ptr<GraphicalObject> &bubble, Point3 c) {
+    scene.addObject(new Instance(bubble, Transform::translation(c)));
 }
 
 float to_rad(float degres) {
     return degres * (M_PI / 180);
 }
 
-int main(int argc, char **argv) {
-    // Read command lines arguments.
-    QApplication application(argc, argv);
-
-    // Creates a 3D scene
-    Scene scene;
-
+/// The scene displayed when no scene file is given.
+void buildDefaultScene(Scene &scene) {
     // Light at infinity
     Light *light0 = new PointLight(GL_LIGHT0, Point4(1, 1, 1, 0),
                                    Color(1.0, 1.0, 1.0));
@@ -48,11 +70,12 @@ int main(int argc, char **argv) {
     int delta_angle = round(360 / radius);
     int x, y, z;
     z = 5;
+    std::shared_ptr<GraphicalObject> bubble = makeBubble(2.0, Material::glass());
     while (radius > -40) {
         for (int incre_angle = 0; incre_angle < 360; incre_angle += delta_angle) {
             x = round(center + radius * sin(to_rad(incre_angle)));
             y = round(center + radius * cos(to_rad(incre_angle)));
-            addBubble(scene, Point3(x, y, z), 2.0, Material::glass());
+            addBubble(scene, bubble, Point3(x, y, z));
         }
         radius -= 5;
         if(radius == 0)
@@ -60,24 +83,457 @@ int main(int argc, char **argv) {
         z += 4;
         delta_angle = round(360 / abs(radius));
     }
+}
 
+/// Renders into an image of pixels of type TValue (see PixelFormat.h),
+/// to which tiles are converted as they are rendered, and writes it.
+/// When \a keep, the image starts from the existing one if it has the
+/// same size.
+template <typename TValue>
+bool renderCompact(WavefrontRenderer &renderer, int width, int height, int max_depth, bool keep,
+                   const char *filename) {
+    Image2D<TValue> image(width, height);
+    if (keep) {
+        ifstream previous(filename, ios::binary);
+        if (previous.good() && (!Image2DReader<Color>::readAs(image, previous)
+                                || image.w() != width || image.h() != height))
+            image = Image2D<TValue>(width, height);
+    }
+    ImageTileSink<TValue> sink(image);
+    renderer.render(sink, max_depth);
+    ofstream output(filename, ios::binary);
+    return Image2DWriter<TValue>::write(image, output, false);
+}
 
+/// Renders the scene without opening a window, as seen from \a camera.
+/// When \a mapped, tiles are written directly into the file, mapped in
+/// memory, instead of into an image. Otherwise, when \a format is not
+/// empty, the image stores pixels of this format (rgb8, rgb565 or half)
+/// instead of colors.
+///
+/// When \a region (x0, y0, x1, y1) or \a mask is not 0, only these
+/// pixels are rendered (see Renderer::setRegion), and the other ones are
+/// the ones of the existing image if it has the same size.
+///
+/// When \a checkpoint_file is not 0, the rendered tiles are kept in it
+/// and the tiles it holds for the same \a key are not rendered again. It
+/// is removed once the image is written.
+///
+/// When \a nb_workers > 0, tiles are rendered by as many processes (see
+/// DistributedRenderer).
+/// @return 'true' if the image could be written.
+bool renderImage(Scene &scene, const Camera &camera, bool hasBackground, Background *background,
+                 int width, int height, int max_depth, int light_samples, int shadow_samples, bool wavefront,
+                 bool sort_rays, bool mapped, const string &format, const int *region,
+                 const Image2D<unsigned char> *mask, const char *checkpoint_file, std::uint64_t key,
+                 int nb_workers, const char *filename) {
+    std::unique_ptr<Renderer> renderer_ptr;
+    WavefrontRenderer *wavefront_renderer = 0;
+    Checkpoint checkpoint;
+    if (wavefront || sort_rays || mapped || !format.empty() || checkpoint_file != 0 || nb_workers > 0) {
+        if (nb_workers > 0) wavefront_renderer = new DistributedRenderer(scene, nb_workers);
+        else wavefront_renderer = new WavefrontRenderer(scene);
+        wavefront_renderer->setSortRays(sort_rays);
+        if (checkpoint_file != 0) {
+            if (!checkpoint.open(checkpoint_file, width, height, WavefrontRenderer::TILE_SIZE, key))
+                return false;
+            wavefront_renderer->setCheckpoint(&checkpoint);
+        }
+        renderer_ptr.reset(wavefront_renderer);
+    } else
+        renderer_ptr.reset(new Renderer(scene));
+    Renderer &renderer = *renderer_ptr;
+    if (hasBackground) renderer.ptrBackground = background;
+    renderer.setLightSamples(light_samples);
+    renderer.setShadowSamples(shadow_samples);
+    Vector3 dirUL, dirUR, dirLL, dirLR;
+    camera.getViewBox(width, height, dirUL, dirUR, dirLL, dirLR);
+    renderer.setViewBox(camera.position, dirUL, dirUR, dirLL, dirLR);
+    renderer.setResolution(width, height);
+    if (region != 0) renderer.setRegion(region[0], region[1], region[2], region[3]);
+    renderer.setMask(mask);
+    // Pixels outside the region or the mask are the ones of the existing image.
+    bool keep = region != 0 || mask != 0;
+    bool written;
+    if (mapped) {
+        MappedImage output;
+        written = output.open(filename, width, height, keep);
+        if (region != 0) output.setColumns(region[0], region[2]);
+        if (written) wavefront_renderer->render(output, max_depth);
+    } else if (format == "rgb8")
+        written = renderCompact<RGB8>(*wavefront_renderer, width, height, max_depth, keep, filename);
+    else if (format == "rgb565")
+        written = renderCompact<RGB565>(*wavefront_renderer, width, height, max_depth, keep, filename);
+    else if (format == "half")
+        written = renderCompact<RGBHalf>(*wavefront_renderer, width, height, max_depth, keep, filename);
+    else {
+        Image2D<Color> image(width, height);
+        if (keep) {
+            ifstream previous(filename, ios::binary);
+            if (previous.good()) Image2DReader<Color>::read(image, previous);
+        }
+        renderer.render(image, max_depth);
+        ofstream output(filename, ios::binary);
+        written = Image2DWriter<Color>::write(image, output, false);
+    }
+    if (written && checkpoint_file != 0) {
+        checkpoint.close();
+        std::remove(checkpoint_file);
+    }
+    return written;
+}
 
+/// Renders \a nb_frames frames of a film along \a path into \a sink
+/// (see SequenceRenderer). When \a reproject, pixels already seen in the
+/// previous frame are not traced again.
+/// @return 'true' if all frames could be written.
+bool renderFilm(Scene &scene, const CameraPath &path, bool hasBackground, Background *background,
+                int width, int height, int max_depth, int light_samples, int shadow_samples, bool wavefront,
+                bool sort_rays, int nb_frames, bool reproject, FrameSink &sink) {
+    std::unique_ptr<Renderer> renderer_ptr;
+    if (wavefront || sort_rays) {
+        WavefrontRenderer *wavefront_renderer = new WavefrontRenderer(scene);
+        wavefront_renderer->setSortRays(sort_rays);
+        renderer_ptr.reset(wavefront_renderer);
+    } else
+        renderer_ptr.reset(new Renderer(scene));
+    Renderer &renderer = *renderer_ptr;
+    if (hasBackground) renderer.ptrBackground = background;
+    renderer.setLightSamples(light_samples);
+    renderer.setShadowSamples(shadow_samples);
+    SequenceRenderer sequence(renderer);
+    sequence.setReprojection(reproject);
+    return sequence.render(path, nb_frames, width, height, max_depth, sink);
+}
 
-    // Instantiate the viewer.
-    Viewer viewer;
-    // Give a name
-    viewer.setWindowTitle("Ray-tracer preview");
-
-    // Sets the scene
-    viewer.setScene(scene);
 
-    // Make the viewer window visible on screen.
-    viewer.show();
-    // Run main loop.
-    application.exec();
-    return 0;
+void usage(const char *program) {
+    cerr << "Usage: " << program << " [scene] [-c compiled_scene] [-o image.ppm] [-s WxH] [-d depth] [-e size]" << endl
+         << "       [-l samples] [-a samples] [-w] [-r] [-m] [-f format]" << endl
+         << "       [-g x0,y0,x1,y1] [-k mask.ppm] [-p checkpoint] [-j workers]" << endl
+         << "       [-v camera] [-S socket] [-q socket] [-y priority] [-n frames] [-t]" << endl
+         << "  scene               a scene file, text or compiled (default scene otherwise)" << endl
+         << "  -c compiled_scene   writes the scene in the compiled format" << endl
+         << "  -o image.ppm        renders the scene into the image, without window" << endl
+         << "  -s WxH              size of the rendered image (default 640x480)" << endl
+         << "  -d depth            maximal depth of the rendering (default 6)" << endl
+         << "  -e size             precomputes the background and the lights at infinity" << endl
+         << "                      into an environment map of faces size x size" << endl
+         << "  -l samples          number of lights sampled at each point (default all)" << endl
+         << "  -a samples          area lights are sampled on samples x samples points" << endl
+         << "                      in penumbrae (default 8)" << endl
+         << "  -w                  renders tiles in waves of rays (see WavefrontRenderer)" << endl
+         << "  -r                  same as -w, sorting reflected and refracted rays" << endl
+         << "  -m                  same as -w, writing tiles directly into the image file" << endl
+         << "                      mapped in memory, for images too big for the memory" << endl
+         << "  -f format           same as -w, storing the image as rgb8, rgb565 or half" << endl
+         << "                      pixels instead of colors (4, 6 or 2 times less memory)" << endl
+         << "  -g x0,y0,x1,y1      only renders the pixels [x0,x1[ x [y0,y1[ of the image," << endl
+         << "                      keeping the other ones of the existing image" << endl
+         << "  -k mask.ppm         only renders the pixels that are not black in the mask" << endl
+         << "  -p checkpoint       same as -w, keeping the rendered tiles in the file, from" << endl
+         << "                      which a stopped render with the same settings resumes" << endl
+         << "  -j workers          same as -w, rendering tiles in as many processes" << endl
+         << "  -v px,py,pz,tx,ty,tz,ux,uy,uz,fov" << endl
+         << "                      the camera (position, target, up, fov), replacing the" << endl
+         << "                      one of the scene" << endl
+         << "  -S socket           serves render jobs on the socket, keeping scenes loaded" << endl
+         << "                      (see RenderServer)" << endl
+         << "  -q socket           sends the render of the scene into the image to the" << endl
+         << "                      server listening on the socket" << endl
+         << "  -y priority         priority of the job sent with -q (default 0)" << endl
+         << "  -n frames           renders as many frames along the keyframes of the scene" << endl
+         << "                      (or its camera) into -o, which is a printf pattern of" << endl
+         << "                      the frame number (e.g. frame%04d.ppm), a video film.y4m" << endl
+         << "                      or film.rgb (raw RGB), or - for a video on the output" << endl
+         << "  -t                  reprojects the pixels of the previous frame of the film," << endl
+         << "                      only tracing the points that were not seen (the camera" << endl
+         << "                      must be the only thing moving)" << endl;
 }
 
+int main(int argc, char **argv) {
+    // Read command lines arguments.
+    const char *scene_file = 0;
+    const char *compiled_file = 0;
+    const char *image_file = 0;
+    int width = 640, height = 480, max_depth = 6, environment_size = 0;
+    int light_samples = 0, shadow_samples = 8;
+    bool wavefront = false, sort_rays = false, mapped = false;
+    string format;
+    int region[4];
+    bool has_region = false;
+    const char *mask_file = 0;
+    const char *checkpoint_file = 0;
+    int nb_workers = 0;
+    const char *serve_socket = 0;
+    const char *submit_socket = 0;
+    int nb_frames = 0;
+    bool reproject = false;
+    RenderJob job;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-c" && has_value) compiled_file = argv[++i];
+        else if (arg == "-o" && has_value) image_file = argv[++i];
+        else if (arg == "-s" && has_value) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-d" && has_value) max_depth = atoi(argv[++i]);
+        else if (arg == "-e" && has_value) environment_size = atoi(argv[++i]);
+        else if (arg == "-l" && has_value) light_samples = atoi(argv[++i]);
+        else if (arg == "-a" && has_value) shadow_samples = atoi(argv[++i]);
+        else if (arg == "-w") wavefront = true;
+        else if (arg == "-r") sort_rays = true;
+        else if (arg == "-m") mapped = true;
+        else if (arg == "-f" && has_value) {
+            format = argv[++i];
+            if (format != "rgb8" && format != "rgb565" && format != "half") {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "-g" && has_value) {
+            has_region = true;
+            if (sscanf(argv[++i], "%d,%d,%d,%d", &region[0], &region[1], &region[2], &region[3]) != 4) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-k" && has_value) mask_file = argv[++i];
+        else if (arg == "-p" && has_value) checkpoint_file = argv[++i];
+        else if (arg == "-j" && has_value) nb_workers = atoi(argv[++i]);
+        else if (arg == "-v" && has_value) {
+            Camera &c = job.camera;
+            job.hasCamera = true;
+            if (sscanf(argv[++i], "%f,%f,%f,%f,%f,%f,%f,%f,%f,%f",
+                       &c.position[0], &c.position[1], &c.position[2], &c.target[0], &c.target[1],
+                       &c.target[2], &c.up[0], &c.up[1], &c.up[2], &c.fov) != 10) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-S" && has_value) serve_socket = argv[++i];
+        else if (arg == "-q" && has_value) submit_socket = argv[++i];
+        else if (arg == "-y" && has_value) job.priority = atoi(argv[++i]);
+        else if (arg == "-n" && has_value) nb_frames = atoi(argv[++i]);
+        else if (arg == "-t") reproject = true;
+        else if (arg[0] != '-' && scene_file == 0) scene_file = argv[i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    // A video written on the standard output is not mixed with messages.
+    std::streambuf *output_buffer = cout.rdbuf();
+    if (nb_frames > 0 && image_file != 0 && string(image_file) == "-") cout.rdbuf(cerr.rdbuf());
+    if (compiled_file != 0 && scene_file == 0) {
+        cerr << "Only scene files can be compiled." << endl;
+        return 1;
+    }
+    // Films are rendered frame by frame in memory (see renderFilm).
+    if (nb_frames > 0 && (mapped || !format.empty() || has_region || mask_file != 0
+                          || checkpoint_file != 0 || nb_workers > 0)) {
+        cerr << "Films (-n) cannot be rendered with -m, -f, -g, -k, -p or -j." << endl;
+        return 1;
+    }
 
+    // The server loads the scenes of its jobs.
+    if (serve_socket != 0) {
+        RenderServer server;
+        server.setLightSamples(light_samples);
+        server.setShadowSamples(shadow_samples);
+        server.setWavefront(wavefront);
+        return server.run(serve_socket) ? 0 : 1;
+    }
+    if (submit_socket != 0) {
+        char path[PATH_MAX];
+        if (scene_file == 0 || image_file == 0 || realpath(scene_file, path) == 0) {
+            cerr << "A job needs an existing scene file and an image." << endl;
+            return 1;
+        }
+        job.scene_file = path;
+        job.width = width;
+        job.height = height;
+        job.max_depth = max_depth;
+        ofstream output(image_file, ios::binary);
+        return RenderServer::submit(submit_socket, job, output) ? 0 : 1;
+    }
+
+    // The scene may be given as a scene file, either compiled (mapped
+    // in memory, so the reader is declared first to outlive the scene)
+    // or as text.
+    CompiledSceneReader compiled_reader;
+    SceneReader reader;
+
+    // Creates a 3D scene
+    Scene scene;
+    Camera camera;
+    bool hasCamera = false;
+    CameraPath camera_path;
+    Background *background = 0;
+    bool hasBackground = false;
+
+    if (scene_file != 0 && CompiledSceneReader::isCompiled(scene_file)) {
+        if (!compiled_reader.read(scene, scene_file)) return 1;
+        compiled_reader.displayStatistics(std::cout);
+        camera = compiled_reader.camera;
+        hasCamera = compiled_reader.hasCamera;
+        camera_path = compiled_reader.path;
+        background = compiled_reader.background;
+        hasBackground = compiled_reader.hasBackground;
+        if (compiled_file != 0) {
+            cerr << "The scene is already compiled." << endl;
+            return 1;
+        }
+    } else if (scene_file != 0) {
+        if (!reader.read(scene, scene_file)) return 1;
+        reader.displayStatistics(std::cout);
+        camera = reader.camera;
+        hasCamera = reader.hasCamera;
+        camera_path = reader.path;
+        background = reader.background;
+        hasBackground = reader.hasBackground;
+    } else
+        buildDefaultScene(scene);
+    if (job.hasCamera) {
+        camera = job.camera;
+        hasCamera = true;
+    }
+
+    if (compiled_file != 0) {
+        for (GraphicalObject *obj : scene.myObjects)
+            if (obj != reader.spheres) {
+                cerr << "Only spheres and point lights can be compiled." << endl;
+                return 1;
+            }
+        SphereSet empty;
+        empty.buildIndex();
+        const SphereSet &spheres = reader.spheres != 0 ? *reader.spheres : empty;
+        if (!CompiledSceneWriter::write(compiled_file, spheres, scene.myLights,
+                                        hasCamera ? &camera : 0, camera_path, hasBackground, background))
+            return 1;
+    }
+
+    // Misses then cost a lookup in a table, whatever the background.
+    if (environment_size > 0) {
+        auto t0 = std::chrono::steady_clock::now();
+        EnvironmentMap *environment = new EnvironmentMap(environment_size);
+        // Without a background in the scene, the renderer would use a
+        // BasicBackground: only an explicit 'background none' is black.
+        if (!hasBackground) {
+            BasicBackground basic;
+            environment->add(basic);
+        } else if (background != 0)
+            environment->add(*background);
+        for (Light *light : scene.myLights) environment->addLight(*light);
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+        cout << "Environment map of 6x" << environment_size << "x" << environment_size
+             << " texels computed in " << t.count() << " s." << endl;
+        delete background;
+        background = environment;
+        hasBackground = true;
+    }
+
+    // Pixels of the mask are the ones that are not black.
+    Image2D<unsigned char> mask;
+    if (mask_file != 0) {
+        Image2D<Color> mask_image;
+        ifstream mask_input(mask_file, ios::binary);
+        if (!Image2DReader<Color>::read(mask_image, mask_input)) return 1;
+        if (mask_image.w() != width || mask_image.h() != height) {
+            cerr << "The mask " << mask_file << " is not of size " << width << "x" << height << "." << endl;
+            return 1;
+        }
+        mask = Image2D<unsigned char>(width, height);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                mask.at(x, y) = mask_image.at(x, y).max() > 0.0f;
+    }
+
+    // A checkpoint is only resumed with the same scene file, the same
+    // files referenced by it and the same options (except the output
+    // files).
+    std::uint64_t key = 0;
+    if (checkpoint_file != 0) {
+        if (scene_file != 0) {
+            ifstream input(scene_file, ios::binary);
+            std::vector<char> buffer(1 << 16);
+            key = Checkpoint::hash(0, 0);
+            while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0)
+                key = Checkpoint::hash(buffer.data(), input.gcount(), key);
+        }
+        // Meshes and skies may be big: their size and modification time
+        // stand for their content.
+        for (const string &file : reader.files) {
+            struct stat status;
+            std::int64_t info[2] = {-1, -1};
+            if (::stat(file.c_str(), &status) == 0) {
+                info[0] = (std::int64_t) status.st_size;
+                info[1] = (std::int64_t) status.st_mtime;
+            }
+            key = Checkpoint::hash(file.c_str(), file.size() + 1, key);
+            key = Checkpoint::hash(info, sizeof(info), key);
+        }
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if ((arg == "-o" || arg == "-p" || arg == "-c" || arg == "-j") && i + 1 < argc) ++i;
+            else key = Checkpoint::hash(arg.c_str(), arg.size() + 1, key);
+        }
+        if (mask_file != 0) key = Checkpoint::hash(&mask.at(0, 0), width * height, key);
+    }
 
+    int result = 0;
+    if (image_file != 0 && nb_frames > 0) {
+        // Without keyframes, the film is seen from the camera of the scene.
+        if (camera_path.nbKeyFrames() == 0) camera_path.addKeyFrame(0.0f, camera);
+        else if (job.hasCamera) cout << "The camera -v is ignored for the keyframes of the scene." << endl;
+        string name = image_file;
+        auto ends_with = [&name](const string &end) {
+            return name.size() >= end.size() && name.compare(name.size() - end.size(), end.size(), end) == 0;
+        };
+        std::unique_ptr<FrameSink> sink;
+        ostream video(output_buffer);
+        ofstream video_file;
+        if (name == "-" || ends_with(".y4m") || ends_with(".rgb")) {
+            if (name != "-") {
+                video_file.open(image_file, ios::binary);
+                video.rdbuf(video_file.rdbuf());
+            }
+            if (ends_with(".rgb")) sink.reset(new RawFrameSink(video));
+            else sink.reset(new Y4MFrameSink(video));
+        } else if (name.find('%') != string::npos)
+            sink.reset(new PPMFrameSink(name));
+        if (sink == 0) {
+            cerr << "The frames need a pattern such as frame%04d.ppm, or a video." << endl;
+            result = 1;
+        } else if (!renderFilm(scene, camera_path, hasBackground, background, width, height, max_depth,
+                               light_samples, shadow_samples, wavefront, sort_rays, nb_frames, reproject, *sink))
+            result = 1;
+    } else if (image_file != 0) {
+        if (!renderImage(scene, camera, hasBackground, background, width, height, max_depth, light_samples,
+                         shadow_samples, wavefront, sort_rays, mapped, format, has_region ? region : 0,
+                         mask_file != 0 ? &mask : 0, checkpoint_file, key, nb_workers, image_file))
+            result = 1;
+    }
+    else if (compiled_file == 0) {
+        QApplication application(argc, argv);
+        // Instantiate the viewer.
+        Viewer viewer;
+        if (hasCamera) viewer.setCamera(camera);
+        if (hasBackground) viewer.setBackground(background);
+
+        // Give a name
+        viewer.setWindowTitle("Ray-tracer preview");
+
+        // Sets the scene
+        viewer.setScene(scene);
+
+        // Make the viewer window visible on screen.
+        viewer.show();
+        // Run main loop.
+        result = application.exec();
+    }
+    delete background;
+    cout.rdbuf(output_buffer);
+    return result;
+}
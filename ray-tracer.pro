@@ -4,7 +4,7 @@
 # nom de votre executable
 TARGET  = ray-tracer
 # config de l executable
-CONFIG *= qt opengl release
+CONFIG *= qt opengl release thread
 CONFIG += c++11
 # config de Qt
 QT     *= opengl xml
@@ -12,10 +12,22 @@ QMAKE_CXXFLAGS += -std=c++11
 
 # Noms de vos fichiers entete
 HEADERS = Viewer.h PointVector.h Color.h Sphere.h GraphicalObject.h Light.h \
-          Material.h PointLight.h Image2D.h Image2DWriter.h Renderer.h Ray.h
+          Material.h PointLight.h Image2D.h Image2DWriter.h Renderer.h Ray.h \
+          BoundingBox.h BVH.h Background.h Camera.h SphereSet.h SceneReader.h \
+          CompiledScene.h CompiledSceneReader.h CompiledSceneWriter.h \
+          TextParser.h TriangleMesh.h ObjReader.h Transform.h Instance.h \
+          Image2DReader.h EnvironmentMap.h Random.h LightTree.h AreaLight.h \
+          WavefrontRenderer.h Morton.h \
+          TileSink.h MappedImage.h PixelFormat.h Checkpoint.h \
+          DistributedRenderer.h RenderServer.h \
+          CameraPath.h FrameSink.h SequenceRenderer.h VideoFrameSink.h
           
 # Noms de vos fichiers source
-SOURCES = Viewer.cpp ray-tracer.cpp Sphere.cpp 
+SOURCES = Viewer.cpp ray-tracer.cpp Sphere.cpp SphereSet.cpp SceneReader.cpp \
+          CompiledSceneReader.cpp CompiledSceneWriter.cpp TriangleMesh.cpp ObjReader.cpp \
+          Instance.cpp EnvironmentMap.cpp LightTree.cpp WavefrontRenderer.cpp MappedImage.cpp \
+          Checkpoint.cpp DistributedRenderer.cpp RenderServer.cpp \
+          SequenceRenderer.cpp VideoFrameSink.cpp
 
 ###########################################################
 # Commentez/decommentez selon votre config/systeme